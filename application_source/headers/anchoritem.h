@@ -15,7 +15,7 @@
 
 #include <stdint.h> // int64_t; needed for MSVC compiler
 
-enum class ItemType : int {BEGINNING, END, CHANGE};
+enum class ItemType : int {BEGINNING, END, CHANGE, SCENE_CUT};
 
 class AnchorItem : public QWidget
 {
@@ -46,14 +46,31 @@ public:
      * Constructor
      * @param videoAddr Path to a video file
      * @param progressDialog QT progress dialog for displaying information about video opening
+     * @param exportMotionVectors Decoder exports motion vectors of the frames (if the codec supports it)
      */
-    FFmpegPlayer(std::string videoAddr, QProgressDialog const *progressDialog);
+    FFmpegPlayer(std::string videoAddr, QProgressDialog const *progressDialog, bool exportMotionVectors=false);
+
+    /**
+     * Constructor; opens a video that was already analyzed by another player.
+     * This player has its own decoder and can be used from another thread. It exports motion vectors
+     * if the analyzed player does.
+     * @param videoAddr Path to a video file
+     * @param analyzedPlayer Player with the same video already opened
+     */
+    FFmpegPlayer(std::string videoAddr, FFmpegPlayer const &analyzedPlayer);
 
     /**
      * Destructor
      */
     ~FFmpegPlayer();
 
+    /**
+     * Enables / disables exporting of motion vectors by the decoder. Frames decoded afterwards carry them
+     * (if the codec supports it).
+     * @param enabled True if motion vectors should be exported
+     */
+    void set_motion_vectors(bool enabled);
+
     /**
      * Returns information about frames per second.
      * @return Frames per second
@@ -66,6 +83,12 @@ public:
      */
     unsigned long get_frame_count() const;
 
+    /**
+     * Returns timestamps of all keyframes of the video.
+     * @return Keyframe timestamps
+     */
+    std::set<int64_t> const &get_keyframe_timestamps() const;
+
     /**
      * Returns information about video length.
      * @return Video length in milliseconds
@@ -137,6 +160,17 @@ public:
      */
     bool get_previous_frame(VideoFrame *resultFrame);
 
+    /**
+     * Reads frames preceding the frame with a given timestamp. Frames are decoded forward from
+     * the beginning of their GOP, so calling this repeatedly with the timestamp of the first returned
+     * frame walks the video backward decoding each GOP only once (if the GOP fits into the buffer).
+     * @param timestamp Timestamp of the frame following the read frames
+     * @param buffer Frames for storing the read frames; its size is the maximal number of read frames
+     * @param count Returned number of read frames; buffer[0] is the earliest one. 0 if there is no previous frame.
+     * @return True if successful
+     */
+    bool read_frames_backward(int64_t timestamp, std::vector<VideoFrame *> const &buffer, unsigned int &count);
+
     // reads new frame to this.newFrame
     /**
      * Reads a new frame from the input video stream. The new frame is stored in resultFrame.
@@ -166,7 +200,6 @@ public:
      */
     const char *get_format_name();
 
-private:
     /**
      * Converts a given frame timestamp to a time position.
      * @param timestamp Timestamp
@@ -174,14 +207,37 @@ private:
      */
     unsigned long get_time_position_by_timestamp(int64_t timestamp) const; // In miliseconds
 
+    /**
+     * Finds the timestamp of the frame that get_frame_by_time() reads, without reading it.
+     * @param time Time position
+     * @return Timestamp
+     */
+    int64_t get_timestamp_by_time(unsigned long time) const;
+
+    /**
+     * Finds the timestamp of a frame by its number (index), without reading it.
+     * @param frameNumber Frame number (index)
+     * @param timestamp Returned timestamp
+     * @return True if the frame exists
+     */
+    bool get_timestamp_by_number(unsigned long frameNumber, int64_t &timestamp) const;
+
+private:
     /**
      * Analyzes the opened video so that it can be seeked
      * @param progressDialog QT progress dialog for showing an information about analyzation progress.
      */
     void analyze_video(QProgressDialog const *progressDialog);
 
+    /**
+     * Opens a video file and its video decoder.
+     * @param videoAddr Path to a video file
+     */
+    void open_video(std::string const &videoAddr);
+
 private:
     const int scalingMethod;
+    bool exportMotionVectors;
     int videoStreamID;
     int audioStreamID; // -1 => no audio stream found
 
@@ -201,6 +257,7 @@ private:
 
     std::vector<int64_t> framesIndexVector;
     std::set<int64_t> framesTimestampSet;
+    std::set<int64_t> keyframesTimestampSet;
 };
 
 #endif // FFMPEGPLAYER_H
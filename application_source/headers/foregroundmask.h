@@ -0,0 +1,79 @@
+/**
+ * @file foregroundmask.h
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#ifndef FOREGROUNDMASK_H
+#define FOREGROUNDMASK_H
+
+#include <cv.h>
+#include <cvaux.h>
+#include <cxcore.h>
+
+#define VIDEOTRACKING_FOREGROUND_SCALE 4 // The mask is computed in frames downsampled by this factor
+#define VIDEOTRACKING_FOREGROUND_THRESHOLD 300 // Squared difference (sum of channels) of a foreground pixel
+#define VIDEOTRACKING_FOREGROUND_LEARNING_RATE 0.05 // Weight of a new frame in the background reference
+#define VIDEOTRACKING_FOREGROUND_MAX_STEP 5 // Frames further apart are not considered continuous
+
+class ForegroundMask
+{
+public:
+    /**
+     * Constructor
+     */
+    ForegroundMask();
+
+    /**
+     * Computes the mask of the frame against the background reference and updates the reference.
+     * The reference is built from previous frames; it is reset when the frames are not continuous
+     * and the mask is not valid until the next frame.
+     * @param frame Frame data; it may have another size than the frame, e.g. the decoded luma plane
+     * @param frameSize Size of the frame; boxes are given in its coordinates
+     * @param frameNumber Frame number (index)
+     * @return True if the mask is valid
+     */
+    bool update(cv::Mat const &frame, cv::Size frameSize, unsigned long frameNumber);
+
+    /**
+     * Returns the size frames are downsampled to. Frames of this size are not resized by update().
+     * @param frameSize Size of the frame
+     * @return Downsampled size
+     */
+    static cv::Size get_downsampled_size(cv::Size frameSize);
+
+    /**
+     * Invalidates the mask and the reference, e.g. when the frame size changes.
+     */
+    void reset();
+
+    /**
+     * Returns whether the mask of the last updated frame is valid.
+     * @return True if valid
+     */
+    bool is_valid() const;
+
+    /**
+     * Returns number of the last updated frame.
+     * @return Frame number; 0 if no frame was updated
+     */
+    unsigned long get_frame_number() const;
+
+    /**
+     * Returns the portion of foreground pixels inside a box.
+     * @param box Box in frame coordinates
+     * @return Value between 0 and 1; 1 if the mask is not valid
+     */
+    double get_foreground_ratio(cv::Rect const &box) const;
+
+private:
+    cv::Mat small; // Downsampled frame
+    cv::Mat reference; // Background reference; running average of downsampled frames
+    cv::Mat mask; // 1 - foreground, 0 - background
+    cv::Mat integralMask; // Integral image of the mask; sums of boxes are computed in constant time
+    unsigned long frameNumber;
+    bool referenceValid;
+    bool valid;
+};
+
+#endif // FOREGROUNDMASK_H
@@ -0,0 +1,99 @@
+/**
+ * @file framecache.h
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <QImage>
+
+#include <list>
+#include <unordered_map>
+#include <stdint.h> // int64_t; needed for MSVC compiler
+
+#define VIDEOTRACKING_FRAME_CACHE_BUDGET (256 * 1024 * 1024) // Bytes of rendered frames kept for scrubbing
+
+/**
+ * Least recently used cache of rendered frames. A frame is stored with the revision of the objects
+ * it was rendered with and is found only with the same revision, so frames with outdated marks
+ * are never returned.
+ */
+class FrameCache
+{
+public:
+    /**
+     * Constructor
+     * @param budget Maximal size of the stored images in bytes
+     */
+    FrameCache(size_t budget=VIDEOTRACKING_FRAME_CACHE_BUDGET);
+
+    /**
+     * Finds a rendered frame.
+     * @param timestamp Timestamp of the frame
+     * @param revision Current revision of the objects
+     * @param includeOriginal The original frame is needed as well
+     * @param image Returned frame with marks
+     * @param originalImage Returned original frame; only if includeOriginal
+     * @param timePosition Returned time position of the frame
+     * @param frameNumber Returned number of the frame
+     * @return True if found
+     */
+    bool find(int64_t timestamp, unsigned long revision, bool includeOriginal, QImage &image, QImage &originalImage,
+              unsigned long &timePosition, unsigned long &frameNumber);
+
+    /**
+     * Stores a rendered frame. The least recently used frames are removed to keep the budget.
+     * @param timestamp Timestamp of the frame
+     * @param revision Revision of the objects the frame was rendered with
+     * @param image Frame with marks
+     * @param originalImage Original frame; null if not rendered
+     * @param timePosition Time position of the frame
+     * @param frameNumber Number of the frame
+     */
+    void insert(int64_t timestamp, unsigned long revision, QImage const &image, QImage const &originalImage,
+                unsigned long timePosition, unsigned long frameNumber);
+
+    /**
+     * Removes a stored frame.
+     * @param timestamp Timestamp of the frame
+     */
+    void remove(int64_t timestamp);
+
+    /**
+     * Removes all stored frames.
+     */
+    void clear();
+
+    /**
+     * Returns the maximal size of the stored images.
+     * @return Budget in bytes
+     */
+    size_t get_budget() const;
+
+private:
+    struct Entry
+    {
+        int64_t timestamp;
+        unsigned long revision;
+        QImage image;
+        QImage originalImage;
+        unsigned long timePosition;
+        unsigned long frameNumber;
+        size_t bytes;
+    };
+
+    /**
+     * Removes a stored frame.
+     * @param entry Frame to be removed
+     */
+    void erase(std::list<Entry>::iterator entry);
+
+    size_t budget;
+    size_t bytes; // Size of all stored images
+    std::list<Entry> entries; // The most recently used first
+    std::unordered_map<int64_t, std::list<Entry>::iterator> index; // Entries by timestamp
+};
+
+#endif // FRAMECACHE_H
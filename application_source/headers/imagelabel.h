@@ -9,6 +9,7 @@
 
 #include "selection.h"
 
+#include <QImage>
 #include <QLabel>
 #include <QMouseEvent>
 //#include <QPoint>
@@ -33,8 +34,14 @@ public:
      * @param image Original image
      * @param displayWidth Maximal allowed width (with respect to the current size of the window)
      * @param displayHeight Maximal allowed height
+     * @param sourceSize Size of the video the image shows; invalid - the size of the image
      */
-    void set_image(QImage const &image, int displayWidth, int displayHeight);
+    void set_image(QImage const &image, int displayWidth, int displayHeight, QSize const &sourceSize=QSize());
+
+    /**
+     * Removes the image; nothing is painted.
+     */
+    void clear_image();
 
     /**
      * Returns position of the currently selected area.
@@ -56,6 +63,11 @@ protected:
      */
     void resizeEvent(QResizeEvent *);
 
+    /**
+     * Paints the image scaled to the display size and the selection.
+     */
+    void paintEvent(QPaintEvent *);
+
     /**
      * Handles mouse press events over the ImageLabel area.
      * @param event
@@ -92,13 +104,14 @@ private:
     //bool isSelected; // selection exists, therefore is displayed
     int posX; // x coordinate, where the selection starts
     int posY; // y coordinate, where the selection starts
-    int imgWidth; // width of original (unscaled) image
+    int imgWidth; // width of original (unscaled) image; the video width
     int imgHeight; // height of original (unscaled) image
 
     int scaledWidth; // width of image at the time of selecting
     int scaledHeight;
     Selection selection; // selection geometry - values with respect to scaledWidth and scaledHeight
-    QImage scaledImage;
+    QImage image; // Shared with the frame given by the tracker; not copied
+    QSize displaySize; // Size the image is painted in
 
 };
 
@@ -0,0 +1,72 @@
+/**
+ * @file imagepool.h
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#ifndef IMAGEPOOL_H
+#define IMAGEPOOL_H
+
+#include <cv.h>
+#include <cxcore.h>
+
+#include <QImage>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#define VIDEOTRACKING_IMAGE_POOL_SIZE 4 // Buffers kept for reuse besides those held by the frame cache
+
+/**
+ * Pool of buffers for frames displayed in QT. A buffer is wrapped by QImage without copying and
+ * returns to the pool when the last copy of the QImage is destroyed. Frames are therefore converted
+ * straight into the memory the widgets paint from.
+ */
+class ImagePool
+{
+public:
+    /**
+     * Constructor
+     * @param maxBuffers Maximal number of buffers kept for reuse
+     */
+    ImagePool(unsigned int maxBuffers=VIDEOTRACKING_IMAGE_POOL_SIZE);
+
+    /**
+     * Returns an RGB32 image backed by a free buffer. The buffer is not initialized.
+     * @param width Image width
+     * @param height Image height
+     * @param mat Returned header of the buffer; 4 channels in BGRA order (RGB32 on little-endian machines)
+     * @return Image sharing the buffer with mat
+     */
+    QImage get(int width, int height, cv::Mat &mat);
+
+    /**
+     * Sets the maximal number of buffers kept for reuse; it applies to the following images.
+     * @param maxBuffers Maximal number of buffers
+     */
+    void set_max_buffers(unsigned int maxBuffers);
+
+    /**
+     * Frees all buffers that are not used; used buffers are freed with their last image.
+     */
+    void clear();
+
+private:
+    struct Buffer
+    {
+        cv::Mat data;
+        std::atomic<bool> used;
+    };
+
+    /**
+     * Returns a buffer to the pool; called by QImage when its last copy is destroyed.
+     * @param info Pointer to std::shared_ptr of the buffer
+     */
+    static void release(void *info);
+
+    unsigned int maxBuffers;
+    std::vector<std::shared_ptr<Buffer>> buffers;
+};
+
+#endif // IMAGEPOOL_H
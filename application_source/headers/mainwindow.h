@@ -110,6 +110,12 @@ private:
      */
     void set_appearance_tab(unsigned int id);
 
+    /**
+     * Fills the General tab with values.
+     * @param id Object ID
+     */
+    void set_general_tab(unsigned int id);
+
     /**
      * Restores default values of the Appearance tab.
      */
@@ -122,6 +128,12 @@ private:
     void show_frame_by_timestamp(int64_t timestamp);
 
 
+    /**
+     * Returns the appearance new objects get.
+     * @return Default appearance
+     */
+    Characteristics get_default_appearance();
+
     /**
      * Confirms adding a new tracked object.
      * @param selectedPosition Position of the new object
@@ -316,6 +328,11 @@ private slots:
      */
     void add_new_object();
 
+    /**
+     * Detects objects by a cascade classifier selected by the user and adds them as tracked objects.
+     */
+    void detect_objects();
+
     /**
      * Sets GUI to look like before adding new object.
      */
@@ -362,6 +379,11 @@ private slots:
      */
     void change_defocus_size();
 
+    /**
+     * Changes whether the object is defocused by blurring.
+     */
+    void change_blur();
+
     /**
      * Changes the object to be defocused.
      */
@@ -400,6 +422,22 @@ private slots:
      */
     void delete_object();
 
+    /**
+     * Changes the tracking stride of the object.
+     */
+    void change_tracking_stride();
+
+    /**
+     * Changes the tracking preset of the object.
+     */
+    void change_tracking_preset();
+
+    /**
+     * Changes the tracking options of the object: the face mode (positions are pre-filtered by skin color)
+     * and the PCA appearance model.
+     */
+    void change_tracking_options();
+
     /**
      * Switches the appliction to Czech.
      */
@@ -473,11 +511,36 @@ private slots:
      */
     void show_original_video();
 
+    /**
+     * Sets / unsets tracking at a reduced resolution.
+     */
+    void reduce_tracking_resolution();
+
+    /**
+     * Sets / unsets pruning of particles by a foreground mask.
+     */
+    void gate_by_foreground();
+
+    /**
+     * Sets / unsets tracking in luma only.
+     */
+    void track_luma_only();
+
+    /**
+     * Sets / unsets shifting of particles by the motion vectors of the video.
+     */
+    void use_motion_prior();
+
     /**
      * Computes all trajectory for the object
      */
     void compute_trajectory();
 
+    /**
+     * Tracks the object backward from the trajectory item being edited.
+     */
+    void track_backward();
+
     /**
      * Shows frame of the selected trajectory item.
      * @param item Selected item
@@ -501,6 +564,10 @@ private:
     QSettings *settings;
     bool displayTime; //false ~ show frame numbers
     bool showOriginalVideo;
+    bool reducedTracking; // Objects are tracked in frames scaled down to a lower resolution
+    bool foregroundGating; // Particles without foreground are not evaluated
+    bool lumaTracking; // Objects are tracked in the luma plane without color conversion
+    bool motionPrior; // Particles are shifted by the motion vectors of the video
 
     QImage frame;
     QImage originalFrame;
@@ -519,6 +586,9 @@ private:
     bool projectChanged; // to ask if user wants to save it
     bool settingObjectSettings;
     bool isEndTimestampSet; // used with AnchorItem - determining whether to show option "Track till the end of the video"
+    bool anchorsSceneCut; // The Anchors tab shows a scene cut
+    unsigned int trajectoryTabObject; // Object shown in the Trajectory tab
+    unsigned long trajectoryTabVersion; // Version of the trajectory shown in the Trajectory tab; 0 - the tab is empty
     std::string inputFileName;
 
     // Last loaded/saved project; FileDialog starts with at this path.
@@ -530,6 +600,7 @@ private:
     std::map<unsigned int, std::pair<std::string, ObjectColor>> colorsMap;
     unsigned int customColorsCount;
     std::map<unsigned int, QString> shapesMap;
+    std::map<unsigned int, QString> trackingPresetsMap;
 
     Characteristics originalObjectAppearance;
     Characteristics alteredObjectAppearance;
@@ -0,0 +1,189 @@
+/**
+ * @file markcompositor.h
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#ifndef MARKCOMPOSITOR_H
+#define MARKCOMPOSITOR_H
+
+#include "trackedobject.h"
+#include "selection.h"
+
+#include <cv.h>
+#include <cxcore.h>
+
+#include <vector>
+
+#define VIDEOTRACKING_BLUR_KERNEL_SIGMAS 3.0 // Radius of the blur (defocus size) in multiples of sigma
+#define VIDEOTRACKING_BLUR_MAX_SIGMA 4.0 // Stronger blur is computed in a region scaled down by an integer factor
+#define VIDEOTRACKING_COMPOSITOR_TILE_ROWS 64 // Minimal height of a tile drawn in parallel when tiles are chosen automatically
+
+/**
+ * Draws marks of all objects visible in a frame at once. Areas of the objects (fills and defocused regions)
+ * are first rasterized into a map of labels, so each pixel is written only by the object drawn last over it.
+ * The covered rows are then swept once. Defocused objects are computed from the frame before anything is
+ * written, so they never involve other objects, and only their visible parts are computed.
+ * The sweep is split into horizontal tiles drawn in parallel; the output does not depend on the tiles.
+ */
+class MarkCompositor
+{
+public:
+    /**
+     * Constructor
+     */
+    MarkCompositor();
+
+    /**
+     * Sets the number of horizontal tiles the covered rows are split into.
+     * @param count Number of tiles; 0 - chosen by the number of threads and the covered height
+     */
+    void set_tile_count(unsigned int count);
+
+    /**
+     * Returns statistics of drawing since the last call and resets them.
+     * @param frames Returned number of frames drawn
+     * @param averageTime Returned average time of drawing a frame; in milliseconds
+     * @param tiles Returned number of tiles the last plane was split into
+     */
+    void take_statistics(unsigned long &frames, double &averageTime, unsigned int &tiles);
+
+    /**
+     * Adds the mark of an object. Marks are drawn in the order they were added.
+     * @param object Object
+     * @param timestamp Timestamp of the frame
+     * @return False if the object has no position in the frame; there is nothing to draw for it
+     */
+    bool add(TrackedObject const &object, int64_t timestamp);
+
+    /**
+     * Removes all added marks.
+     */
+    void clear();
+
+    /**
+     * Returns whether no mark was added.
+     * @return True if empty
+     */
+    bool empty() const;
+
+    /**
+     * Draws the added marks into a BGR or BGRA frame.
+     * @param frame Frame for drawing
+     * @param scale Scale of the frame relative to the video
+     */
+    void compose(cv::Mat &frame, double scale=1);
+
+    /**
+     * Draws the added marks into the Y, U and V planes of a picture.
+     * @param planes Planes for drawing; chroma planes may be subsampled
+     */
+    void compose(std::vector<cv::Mat> &planes);
+
+private:
+    struct Mark
+    {
+        Characteristics appearance;
+        Selection position; // In the coordinates of the video
+    };
+
+    enum Effect
+    {
+        NONE, // Only the border is drawn
+        FILL,
+        PIXELATE,
+        BLUR
+    };
+
+    struct PlaneMark
+    {
+        Characteristics const *appearance;
+        Selection position; // In the coordinates of the plane
+        cv::Scalar color;
+        cv::Scalar borderColor;
+        int defocusSize;
+        int borderThickness;
+
+        Effect effect;
+        cv::Rect area; // Pixels the effect may cover
+        bool visible; // Some of the area is not covered by following marks
+        cv::Mat blocks; // PIXELATE: mean of each block
+        cv::Mat visibleBlocks; // PIXELATE: blocks that are not fully covered by following marks
+        cv::Mat blurred; // BLUR: the area blurred
+    };
+
+    /**
+     * Prepares a mark for drawing into a plane.
+     * @param mark Mark
+     * @param scale Scale of the plane relative to the video; sizes of squares, blur and border are scaled
+     * @param color Fill color in the plane's color space
+     * @param borderColor Border color in the plane's color space
+     * @return Mark in the plane's coordinates
+     */
+    PlaneMark get_plane_mark(Mark const &mark, double scale, cv::Scalar const &color, cv::Scalar const &borderColor) const;
+
+    /**
+     * Draws marks into one plane.
+     * @param frame Frame or plane for drawing
+     * @param marks Marks in the plane's coordinates and color space
+     * @param labels Buffer for the map of labels; kept zeroed between calls
+     */
+    void compose_plane(cv::Mat &frame, std::vector<PlaneMark> &marks, cv::Mat &labels);
+
+    /**
+     * Rasterizes the area of a mark into the map of labels.
+     * @param labels Map of labels; of the plane's size
+     * @param mark Mark
+     * @param label Label of the mark
+     */
+    void rasterize(cv::Mat &labels, PlaneMark const &mark, int label) const;
+
+    /**
+     * Calls a function for each run of equally labelled pixels inside the areas of the marks.
+     * @param labels Map of labels
+     * @param marks Marks with their areas set
+     * @param firstRow First row to be processed
+     * @param lastRow Row following the last one to be processed
+     * @param function Called with the row, the first and the last column of the run (exclusive) and the label
+     */
+    template<class Function>
+    void for_each_run(cv::Mat const &labels, std::vector<PlaneMark> const &marks, int firstRow, int lastRow,
+                      Function function) const;
+
+    /**
+     * Computes the means of the visible blocks of a pixelated mark from the integral image of its area.
+     * @param frame Frame before any mark was drawn
+     * @param mark Pixelated mark
+     */
+    void compute_blocks(cv::Mat const &frame, PlaneMark &mark) const;
+
+    /**
+     * Blurs the area of a mark.
+     * @param frame Frame before any mark was drawn
+     * @param mark Blurred mark
+     */
+    void compute_blur(cv::Mat const &frame, PlaneMark &mark) const;
+
+    /**
+     * Draws the border of a mark.
+     * @param frame Frame for drawing
+     * @param mark Mark
+     */
+    void draw_border(cv::Mat &frame, PlaneMark const &mark) const;
+
+    /**
+     * Converts a color of the appearance to the YUV of the output format.
+     * @param color Color
+     * @return Y, U and V values
+     */
+    static cv::Scalar to_yuv(ObjectColor const &color);
+
+    std::vector<Mark> marks;
+    std::vector<cv::Mat> labels; // One map of labels per plane; reused between frames
+    unsigned int tileCount; // 0 - automatic
+    unsigned int lastTiles;
+    unsigned long framesDrawn;
+    double drawingTime; // In milliseconds
+};
+
+#endif // MARKCOMPOSITOR_H
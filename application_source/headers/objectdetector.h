@@ -0,0 +1,62 @@
+/**
+ * @file objectdetector.h
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#ifndef OBJECTDETECTOR_H
+#define OBJECTDETECTOR_H
+
+#include "selection.h"
+
+#include <cv.h>
+#include <cxcore.h>
+#include <opencv2/objdetect/objdetect.hpp>
+
+#include <string>
+#include <vector>
+
+#define VIDEOTRACKING_DETECTION_HEIGHT 540 // Frames are scaled down to this height before detection
+#define VIDEOTRACKING_DETECTION_MIN_SIZE 24 // Smallest detected object in pixels of the scaled frame
+
+class ObjectDetector
+{
+public:
+    /**
+     * Constructor
+     */
+    ObjectDetector();
+
+    /**
+     * Loads a trained cascade classifier, e.g. haarcascade_frontalface_default.xml distributed with OpenCV.
+     * @param cascadeFile Path to the cascade file
+     * @return True if successful
+     */
+    bool load(std::string const &cascadeFile);
+
+    /**
+     * Detects objects in a frame.
+     * @param frame Frame data (BGR)
+     * @return Positions of detected objects in frame coordinates
+     */
+    std::vector<Selection> detect(cv::Mat const &frame);
+
+    /**
+     * Returns the time spent by detection since the detector was created.
+     * @return Time in milliseconds
+     */
+    double get_detection_time() const;
+
+    /**
+     * Returns number of frames the detection ran on.
+     * @return Number of frames
+     */
+    unsigned long get_detected_frames() const;
+
+private:
+    cv::CascadeClassifier classifier;
+    double detectionTime; // In milliseconds
+    unsigned long detectedFrames;
+};
+
+#endif // OBJECTDETECTOR_H
@@ -0,0 +1,65 @@
+/**
+ * @file projectformat.h
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#ifndef PROJECTFORMAT_H
+#define PROJECTFORMAT_H
+
+#include <cereal/cereal.hpp>
+
+#include <cstdint>
+
+#define VIDEOTRACKING_PROJECT_FORMAT 1 // Increased whenever a field is added to saved projects
+
+/**
+ * Format of the project being loaded. It is saved as the first field of a project; projects saved
+ * before it existed have the format 0. Objects read only the fields the format contains, fields
+ * added later keep the values set by their constructors.
+ */
+class ProjectFormat
+{
+public:
+    /**
+     * Constructor; sets the format of the project being loaded until destroyed.
+     * @param format Format read from the project
+     */
+    ProjectFormat(std::uint32_t format);
+
+    /**
+     * Destructor; the current format is used again.
+     */
+    ~ProjectFormat();
+
+    /**
+     * Returns the format of the project being loaded.
+     * @return Format; the current format when no project is being loaded, e.g. when saving
+     */
+    static std::uint32_t get();
+
+    /**
+     * Reads the format of a project.
+     * @param archive Input archive that did not read any field yet
+     * @return Format; 0 if the project does not contain it
+     */
+    template<class Archive>
+    static std::uint32_t load(Archive &archive)
+    {
+        std::uint32_t projectFormat = 0;
+        try
+        {
+            archive(CEREAL_NVP(projectFormat));
+        }
+        catch (cereal::Exception const &)
+        { // The field was not found; the archive did not move
+        }
+
+        return projectFormat;
+    }
+
+private:
+    static std::uint32_t loadedFormat;
+};
+
+#endif // PROJECTFORMAT_H
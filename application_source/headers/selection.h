@@ -6,12 +6,18 @@
 
 #include <objectshape.h>
 #include <colors.h>
+#include <trackingpreset.h>
+#include <projectformat.h>
 
 #include <cereal/types/utility.hpp>
 
 #ifndef SELECTION
 #define SELECTION
 
+#define VIDEOTRACKING_FACE_EVALUATED 0.3 // Portion of particles compared with the template in face mode
+#define VIDEOTRACKING_PCA_COMPONENTS 3 // Dimension of the appearance subspace of the PCA model
+#define VIDEOTRACKING_PCA_PATCH 8 // Side of the patches compared by the PCA model; in pixels
+
 struct Selection
 {
     template<class Archive>
@@ -56,26 +62,28 @@ struct ObjectColor
 struct Characteristics
 { //    Characteristics(): shape(ObjectShape::RECTANGLE), color(0,0,0), colorName("Black"), borderColor(0,0,0), borderColorName("Black"), borderThickness(3) { }
 
-    // CEREAL serialization
+    // CEREAL serialization; project format 1 adds blur
     template<class Archive>
     void serialize(Archive &archive)
     {
         archive(CEREAL_NVP(shape), CEREAL_NVP(defocus), CEREAL_NVP(defocusSize), CEREAL_NVP(drawInside), CEREAL_NVP(color), CEREAL_NVP(colorID), CEREAL_NVP(drawBorder), CEREAL_NVP(borderColor), CEREAL_NVP(borderColorID), CEREAL_NVP(borderThickness));
+        if (ProjectFormat::get() >= 1)
+            archive(CEREAL_NVP(blur));
     }
 
     // Default constructor
     Characteristics(): shape(ObjectShape::RECTANGLE), defocus(false), defocusSize(20),
             drawInside(true), color(ObjectColor(0, 0, 0)), colorID(Colors::BLACK),
             drawBorder(true), borderColor(ObjectColor(0,0,0)), borderColorID(Colors::BLACK),
-            borderThickness(3) { }
+            borderThickness(3), blur(false) { }
 
     // Constructor with arguments
     Characteristics(unsigned int shape, bool defocus, unsigned int defocusSize, bool drawInside,
                         ObjectColor color, unsigned int colorID, bool drawBorder, ObjectColor borderColor,
-                        unsigned int borderColorID, int borderThickness) :
+                        unsigned int borderColorID, int borderThickness, bool blur=false) :
             shape(shape), defocus(defocus), defocusSize(defocusSize), drawInside(drawInside), color(color),
             colorID(colorID), drawBorder(drawBorder), borderColor(borderColor), borderColorID(borderColorID),
-            borderThickness(borderThickness) { }
+            borderThickness(borderThickness), blur(blur) { }
 
     //ObjectShape shape;
     unsigned int shape;
@@ -88,7 +96,63 @@ struct Characteristics
     ObjectColor borderColor;
     unsigned int borderColorID;
     int borderThickness;
+    bool blur; // Defocused by blurring instead of squares; defocusSize is the radius of the blur
+
+};
+
+struct TrackingParameters
+{
+    // CEREAL serialization; saved since project format 1
+    template<class Archive>
+    void serialize(Archive &archive)
+    {
+        archive(CEREAL_NVP(preset), CEREAL_NVP(particles), CEREAL_NVP(dynamicParticles), CEREAL_NVP(featureWidth),
+                CEREAL_NVP(featureHeight), CEREAL_NVP(noiseX), CEREAL_NVP(noiseY), CEREAL_NVP(faceMode), CEREAL_NVP(pcaModel));
+    }
+
+    // Default constructor; balanced preset
+    TrackingParameters(): preset(TrackingPreset::BALANCED), particles(300), dynamicParticles(100),
+            featureWidth(24), featureHeight(24), noiseX(5), noiseY(5), faceMode(false), pcaModel(false) { }
+
+    // Constructor with arguments
+    TrackingParameters(unsigned int preset, int particles, int dynamicParticles, int featureWidth, int featureHeight,
+                       int noiseX, int noiseY) :
+            preset(preset), particles(particles), dynamicParticles(dynamicParticles), featureWidth(featureWidth),
+            featureHeight(featureHeight), noiseX(noiseX), noiseY(noiseY), faceMode(false), pcaModel(false) { }
+
+    // Returns parameters of a named preset
+    static TrackingParameters from_preset(unsigned int preset)
+    {
+        if (preset == TrackingPreset::FAST) // Small or slow objects
+            return TrackingParameters(preset, 150, 50, 16, 16, 5, 5);
+        else if (preset == TrackingPreset::ACCURATE) // Large or fast objects
+            return TrackingParameters(preset, 600, 200, 32, 32, 7, 7);
+
+        return TrackingParameters();
+    }
+
+    // Predicted cost of tracking one frame relative to the balanced preset;
+    // evaluation of a particle compares all pixels of the feature; the PCA model
+    // projects a small patch onto each component and takes its norm
+    double get_relative_cost() const
+    {
+        TrackingParameters balanced;
+        double evaluated = faceMode ? VIDEOTRACKING_FACE_EVALUATED * dynamicParticles : dynamicParticles;
+        double operations = pcaModel ? VIDEOTRACKING_PCA_PATCH * VIDEOTRACKING_PCA_PATCH * (VIDEOTRACKING_PCA_COMPONENTS + 1) :
+                                       featureWidth * featureHeight;
+        return evaluated * operations /
+                (balanced.dynamicParticles * balanced.featureWidth * balanced.featureHeight);
+    }
 
+    unsigned int preset;
+    int particles; // Number of particles
+    int dynamicParticles; // Number of particles evaluated in each frame
+    int featureWidth; // The object is compared at this size
+    int featureHeight;
+    int noiseX; // Noise of the particles' movement in pixels
+    int noiseY;
+    bool faceMode; // Particles are pre-filtered by skin color; only the best ones are compared with the template
+    bool pcaModel; // Particles are scored by the distance from an appearance subspace instead of the template
 };
 
 #endif // SELECTION
@@ -0,0 +1,51 @@
+/**
+ * @file skincolormap.h
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#ifndef SKINCOLORMAP_H
+#define SKINCOLORMAP_H
+
+#include <cv.h>
+#include <cvaux.h>
+#include <cxcore.h>
+
+#define VIDEOTRACKING_SKIN_SCALE 2 // The map is computed in a region downsampled by this factor
+#define VIDEOTRACKING_SKIN_CR_MIN 133 // Range of skin chrominance in YCrCb
+#define VIDEOTRACKING_SKIN_CR_MAX 173
+#define VIDEOTRACKING_SKIN_CB_MIN 77
+#define VIDEOTRACKING_SKIN_CB_MAX 127
+
+class SkinColorMap
+{
+public:
+    /**
+     * Constructor
+     */
+    SkinColorMap();
+
+    /**
+     * Classifies pixels of a region of the frame as skin / non-skin by a fixed range of their chrominance.
+     * @param frame Frame data (BGR)
+     * @param region Region of the frame the map is computed for
+     */
+    void update(cv::Mat const &frame, cv::Rect const &region);
+
+    /**
+     * Returns the portion of skin pixels inside a box. Only the part of the box inside the region
+     * of the last update is taken into account.
+     * @param box Box in frame coordinates
+     * @return Value between 0 and 1
+     */
+    double get_skin_ratio(cv::Rect const &box) const;
+
+private:
+    cv::Rect region; // Region of the frame covered by the map
+    cv::Mat small; // Downsampled region
+    cv::Mat ycrcb; // Downsampled region in YCrCb
+    cv::Mat mask; // 1 - skin, 0 - other
+    cv::Mat integralMask; // Integral image of the mask; sums of boxes are computed in constant time
+};
+
+#endif // SKINCOLORMAP_H
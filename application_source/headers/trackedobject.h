@@ -8,6 +8,7 @@
 #define TRACKEDOBJECT_H
 
 #include "trackingalgorithm.h"
+#include "trajectory.h"
 #include "videoframe.h"
 
 #include "selection.h"
@@ -23,6 +24,9 @@
 #include <cxcore.h>
 #include <highgui.h>
 
+#include <atomic>
+#include <vector>
+
 /**
 #define VIDEOTRACKING_END_OF_VIDEO -1
 #define VIDEOTRACKING_ALL_PROCESSED -1
@@ -30,17 +34,26 @@
 #define VIDEOTRACKING_NO_PREVIOUS_TIMESTAMP -3 // In case other function than VideoTracker::get_next_frame() is used
 */
 
+#define VIDEOTRACKING_STRIDE_MAX_ERROR 40.0 // Matching error above which sparse tracking falls back to every frame
+#define VIDEOTRACKING_STRIDE_MAX_DISPLACEMENT 0.5 // Movement between two tracked frames; relative to the object size
+#define VIDEOTRACKING_STRIDE_RECOVERY 2 // Number of strides tracked frame by frame before sparse tracking is resumed
+#define VIDEOTRACKING_INTERPOLATED_MARGIN 0.1 // Interpolated marks are enlarged by this ratio
+#define VIDEOTRACKING_SEARCH_MARGIN 0.5 // Search region around the object; relative to the object size
+#define VIDEOTRACKING_SEARCH_NOISE_SPREAD 3 // Particles rarely move further than this multiple of the noise
+#define VIDEOTRACKING_CUT_HISTOGRAM_DISTANCE 0.5 // Bhattacharyya distance of the histograms of the object's box at a scene cut
+#define VIDEOTRACKING_CUT_MAX_ERROR 40.0 // Matching error that confirms the object is lost at a scene cut
+#define VIDEOTRACKING_CUT_THUMBNAIL 32 // The object's box is scaled down to this size before computing a histogram
 
 struct TrajectorySection
 {
-    /**
-     * CEREAL serialization
-     */
+    // CEREAL serialization; project format 1 adds backwardTrajectory
     template<class Archive>
     void serialize(Archive &archive)
     {
         archive(CEREAL_NVP(initialPosition), CEREAL_NVP(initialTimestamp),
                 CEREAL_NVP(initialTimePosition), CEREAL_NVP(initialFrameNumber));
+        if (ProjectFormat::get() >= 1)
+            archive(CEREAL_NVP(backwardTrajectory));
     }
 
     /**
@@ -73,49 +86,17 @@ struct TrajectorySection
     unsigned long initialTimePosition;
     unsigned long initialFrameNumber;
     TrackingAlgorithm *trackingAlgorithm;
+    std::map<int64_t, TrajectoryEntry> backwardTrajectory; // Frames preceding the section tracked backward from it
 //    bool algorithmInitialized;
 };
 
-struct TrajectoryEntry
-{
-    /**
-     * CEREAL serialization
-     */
-    template<class Archive>
-    void serialize(Archive &archive)
-    {
-        archive(CEREAL_NVP(position), CEREAL_NVP(timePosition), CEREAL_NVP(frameNumber));
-    }
-
-    /**
-     * Constructor
-     */
-    TrajectoryEntry() { }
-
-    /**
-     * Constructor
-     * @param position Object position
-     * @param timePosition
-     * @param frameNumber
-     */
-    TrajectoryEntry(Selection position, unsigned long timePosition, unsigned long frameNumber) :
-        position(position),
-        timePosition(timePosition),
-        frameNumber(frameNumber)
-    { }
-
-    Selection position;
-    unsigned long timePosition;
-    unsigned long frameNumber;
-
-};
-
 class TrackedObject
 {
 
 public:
     /**
-     * CEREAL serialization
+     * CEREAL serialization; project format 1 adds trackingStride, trackingParameters and the scene cut.
+     * Fields missing in older projects keep the values set by the constructor.
      */
     template<class Archive>
     void serialize(Archive &archive)
@@ -124,6 +105,10 @@ public:
                 CEREAL_NVP(endTimestampSet), CEREAL_NVP(endTimestamp), CEREAL_NVP(endTimePosition),
                 CEREAL_NVP(endFrameNumber), CEREAL_NVP(trajectorySections), CEREAL_NVP(allProcessed),
                 CEREAL_NVP(trajectory));
+        if (ProjectFormat::get() >= 1)
+            archive(CEREAL_NVP(trackingStride), CEREAL_NVP(trackingParameters), CEREAL_NVP(endedBySceneCut),
+                    CEREAL_NVP(sceneCutTimestamp), CEREAL_NVP(sceneCutTimePosition), CEREAL_NVP(sceneCutFrameNumber),
+                    CEREAL_NVP(ignoredSceneCutFrame));
     }
 
     /**
@@ -217,18 +202,70 @@ public:
     /**
      * Computes position of the object in the next frame.
      * @param frame Next frame
+     * @param timeBudget Time budget for tracking the frame in milliseconds; 0 - no limit, full quality
      * @return Tracked object position
      */
-    Selection track_next(VideoFrame const *frame);
+    Selection track_next(VideoFrame const *frame, double timeBudget=0);
 
     /**
-     * Draws mark of the object in a frame.
-     * @param frame Frame for drawing
-     * @param originalFrame Original frame
+     * Returns the region of the next frame that tracking needs: the surroundings of the last position,
+     * the spread of the particles and the beginning of the next section.
+     * @param frame Tracking frame; its scale is used for the particles' noise
+     * @return Region in source coordinates; empty if the whole frame is needed
+     */
+    cv::Rect get_search_region(VideoFrame const *frame) const;
+
+    /**
+     * Returns whether tracking of the object ended automatically at a scene cut. The object has no position
+     * from the first frame of the new scene; the end frame set by the user is kept.
+     * @return True if ended at a scene cut
+     */
+    bool is_ended_by_scene_cut() const;
+
+    /**
+     * Returns the first frame of the new scene where tracking of the object ended.
+     * @param timestamp Returned timestamp of the frame
+     * @param timePosition Returned time position of the frame
+     * @param frameNumber Returned frame number of the frame
+     * @return False if tracking did not end at a scene cut
+     */
+    bool get_scene_cut(int64_t &timestamp, unsigned long &timePosition, unsigned long &frameNumber) const;
+
+    /**
+     * Returns whether tracking ended at a scene cut in or before the frame.
+     * @param timestamp Frame timestamp
+     * @return True if the object has no position in the frame because of a scene cut
+     */
+    bool is_after_scene_cut(int64_t timestamp) const;
+
+    /**
+     * Ignores the scene cut the tracking ended at; the object is tracked further. Cuts detected up to
+     * this frame are not detected again.
+     * @return False if tracking did not end at a scene cut
+     */
+    bool ignore_scene_cut();
+
+    /**
+     * Returns the revision of the object. It changes whenever its marks may be drawn differently: with
+     * the appearance, sections or already computed positions. Newly tracked and interpolated positions do not change it;
+     * they are reported as changes of the trajectory.
+     * @return Revision; unique among all objects
+     */
+    unsigned long get_revision() const;
+
+    /**
+     * Returns a new revision, higher than any revision returned before.
+     * @return Revision
+     */
+    static unsigned long new_revision();
+
+    /**
+     * Returns position of the mark in a frame.
      * @param timestamp Timestamp of the frame
-     * @return True if successful
+     * @param position Returned position; enlarged if it was interpolated
+     * @return False if the position is not known
      */
-    bool draw_mark(cv::Mat &frame, cv::Mat const &originalFrame, int64_t timestamp) const;
+    bool get_mark_position(int64_t timestamp, Selection &position) const;
 
     /**
      * Returns trajectory sections of the object.
@@ -240,7 +277,7 @@ public:
      * Returns computed trajectory of the object.
      * @return Trajectory of the object
      */
-    std::map<int64_t, TrajectoryEntry> const &get_trajectory() const;
+    Trajectory const &get_trajectory() const;
 
     /**
      * Returns initial timestamp.
@@ -248,6 +285,13 @@ public:
      */
     int64_t get_initial_timestamp() const;
 
+    /**
+     * Returns timestamp of the first frame with a known position. It precedes the initial timestamp
+     * if the Beginning section was tracked backward.
+     * @return First timestamp
+     */
+    int64_t get_first_timestamp() const;
+
     /**
      * Returns end timestamp.
      * @return End timestamp
@@ -314,10 +358,90 @@ public:
     /**
      * Erases a part of the computed trajectory. This is necessary after deserialization (with CEREAL)
      * as track_next() initializes correct sections only when the trajectory's last frame is the last
-     * frame of the previous section.
+     * frame of the previous section. It is also needed when the size of tracking frames changes.
      */
     void erase_trajectory_to_comply();
 
+    /**
+     * Sets the tracking stride. With a stride higher than 1, only every n-th frame is tracked
+     * and positions in the skipped frames are interpolated. Tracking falls back to every frame
+     * while the matching error or the movement of the object is too high.
+     * @param stride Track every n-th frame
+     */
+    void set_tracking_stride(unsigned int stride);
+
+    /**
+     * Returns the tracking stride.
+     * @return Every n-th frame is tracked
+     */
+    unsigned int get_tracking_stride() const;
+
+    /**
+     * Sets tracking parameters. The computed trajectory and the backward trajectories of all sections are erased
+     * so they get tracked again with them.
+     * @param parameters Tracking parameters
+     */
+    void set_tracking_parameters(TrackingParameters const &parameters);
+
+    /**
+     * Returns tracking parameters.
+     * @return Tracking parameters
+     */
+    TrackingParameters get_tracking_parameters() const;
+
+    /**
+     * Erases the trajectory from the beginning of the section in which the first frame tracked
+     * with reduced quality occurs so it gets tracked again at full quality.
+     * @return True if any frame was tracked with reduced quality
+     */
+    bool erase_degraded();
+
+    /**
+     * Sets positions of the frames preceding a section that were tracked backward from the section.
+     * Forward tracking of the previous section stops where these frames begin, so each frame is tracked once.
+     * Frames preceding the Beginning section extend the object's range.
+     * @param sectionTimestamp Initial timestamp of the section
+     * @param entries Positions tracked backward
+     * @return False if the section does not exist
+     */
+    bool set_backward_trajectory(int64_t sectionTimestamp, std::map<int64_t, TrajectoryEntry> const &entries);
+
+private:
+    /**
+     * Returns the trajectory entry of the frame with given timestamp.
+     * @param timestamp Frame timestamp
+     * @return Trajectory entry or nullptr if the position is not known
+     */
+    TrajectoryEntry const *find_entry(int64_t timestamp) const;
+
+    /**
+     * Decides whether the frame can be skipped by sparse tracking.
+     * @param frame Next frame
+     * @return True if the frame needs to be tracked
+     */
+    bool is_stride_frame(VideoFrame const *frame) const;
+
+    /**
+     * Interpolates positions of the frames skipped since the last tracked frame.
+     * @param position Position in the newly tracked frame
+     * @param frameNumber Frame number of the newly tracked frame
+     */
+    void interpolate_skipped(Selection const &position, unsigned long frameNumber);
+
+    /**
+     * Computes a color histogram of the box of the last tracked position. The box is scaled down first
+     * so the histogram is cheap to compute.
+     * @param frame Frame to compute the histogram of
+     * @return Normalized histogram; empty if the box is outside of the frame
+     */
+    cv::Mat compute_histogram(VideoFrame const *frame) const;
+
+    /**
+     * Removes the scene cut the tracking ended at. The section it was detected in is tracked again
+     * from its beginning, so the cut is detected again unless a following section overrides it.
+     */
+    void clear_scene_cut();
+
 private:
     std::string name;
     Characteristics appearance;
@@ -329,12 +453,30 @@ private:
     unsigned long endFrameNumber;
 
     std::map<int64_t, TrajectorySection> trajectorySections;
-    std::map<int64_t, TrajectoryEntry> trajectory;
+    Trajectory trajectory;
 
     TrajectorySection *currentSection;
     bool nextSection;
     int64_t nextSectionTimestamp;
     bool allProcessed;
+
+    unsigned int trackingStride;
+    TrackingParameters trackingParameters;
+    // Sparse tracking state; initialized with each section
+    int64_t lastTrackedTimestamp;
+    unsigned long lastTrackedFrameNumber;
+    Selection lastTrackedPosition;
+    bool strideFallback; // Every frame is tracked until the tracking is reliable again
+    unsigned int reliableFrames; // Reliable frames since the fallback
+    cv::Mat lastHistogram; // Histogram of the object's box in the last tracked frame
+    bool endedBySceneCut; // Tracking ended at a scene cut detected automatically
+    int64_t sceneCutTimestamp; // First frame of the new scene
+    unsigned long sceneCutTimePosition;
+    unsigned long sceneCutFrameNumber;
+    unsigned long ignoredSceneCutFrame; // Scene cuts up to this frame are ignored; 0 - none
+    unsigned long revision;
+
+    static std::atomic<unsigned long> lastRevision;
 };
 
 #endif // TRACKEDOBJECT_H
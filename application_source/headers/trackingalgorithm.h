@@ -8,6 +8,8 @@
 #define TRACKINGALGORITHM_H
 
 #include "selection.h"
+#include "foregroundmask.h"
+#include "skincolormap.h"
 
 #include <cv.h>
 #include <cvaux.h>
@@ -22,9 +24,11 @@ public:
      * Constructor
      * @param initialFrame Data of the first frame
      * @param initialPosition Position of the object in the first frame
+     * @param parameters Tracking parameters of the object
      * @param centerizedPosition Returned position of the object
      */
-    TrackingAlgorithm(cv::Mat const &initialFrame, Selection const &initialPosition, Selection &centerizedPosition);
+    TrackingAlgorithm(cv::Mat const &initialFrame, Selection const &initialPosition, TrackingParameters const &parameters,
+                      Selection &centerizedPosition);
 
     /**
      * Destructor
@@ -38,11 +42,144 @@ public:
      */
     Selection track_next_frame(cv::Mat const &nextImage);
 
+    /**
+     * Sets number of frames between the previously tracked frame and the next one.
+     * Noise of the particles is scaled accordingly so the object can move further.
+     * @param step Number of frames; 1 when every frame is tracked
+     */
+    void set_frame_step(unsigned int step);
+
+    /**
+     * Sets the expected motion of the object in the next frame. Particles are shifted by it
+     * before the noise is added.
+     * @param dx Horizontal motion in pixels
+     * @param dy Vertical motion in pixels
+     */
+    void set_motion_prior(double dx, double dy);
+
+    /**
+     * Sets the foreground mask of the next frame. Particles whose boxes contain almost no foreground
+     * are not evaluated. The mask is used for one frame only.
+     * @param mask Foreground mask; nullptr - all particles are evaluated
+     */
+    void set_foreground_mask(ForegroundMask const *mask);
+
+    /**
+     * Returns number of particles that were not evaluated in the last tracked frame
+     * because of the foreground mask.
+     * @return Number of pruned particles
+     */
+    int get_pruned_particles() const;
+
+    /**
+     * Returns matching error of the best particle in the last tracked frame.
+     * @return Root mean square difference of pixel values (0-255); 0 is a perfect match
+     */
+    double get_match_error() const;
+
+    /**
+     * Returns number of particles that were evaluated in the last tracked frame.
+     * @return Number of evaluated particles
+     */
+    int get_evaluated_particles() const;
+
+    /**
+     * Returns time of evaluating the particles in the last tracked frame.
+     * @return Time in milliseconds
+     */
+    double get_evaluation_time() const;
+
+    /**
+     * Sets time budget for tracking one frame. If the budget cannot be met, fewer particles
+     * are evaluated, eventually at a reduced resolution.
+     * @param budget Time budget in milliseconds; 0 - no limit, full quality
+     */
+    void set_time_budget(double budget);
+
+    /**
+     * Returns whether the last frame was tracked with reduced quality to meet the time budget.
+     * @return True if reduced quality was used
+     */
+    bool is_degraded() const;
+
+private:
+    /**
+     * Chooses the number of evaluated particles and the resolution so the time budget is met.
+     * @param particles Returned number of evaluated particles
+     * @param reduced Returned true if reduced resolution should be used
+     */
+    void apply_time_budget(int &particles, bool &reduced) const;
+
+    /**
+     * Moves particles whose boxes contain enough foreground to the beginning so only they are evaluated.
+     * @param particles Number of particles to be evaluated
+     * @return Number of particles with enough foreground
+     */
+    int prune_by_foreground(int particles);
+
+    /**
+     * Scores particles by the portion of skin color in their boxes and moves the best ones to the beginning.
+     * The particles nearest to the last position are kept regardless of their skin color, so the object is not
+     * lost when the skin color is not detected. The skin color map is computed once per frame in the region
+     * covered by the particles.
+     * @param frame Frame data
+     * @param particles Number of particles to be scored
+     * @return Number of particles to be compared with the template
+     */
+    int prefilter_by_skin(IplImage *frame, int particles);
+
+    /**
+     * Learns the appearance subspace of the PCA model from small patches of the initial box and its shifted,
+     * scaled and brightened variants.
+     * @param frame Initial frame
+     * @param region Initial position of the object
+     */
+    void train_pca_model(IplImage *frame, CvRect region);
+
+    /**
+     * Scores particles by the distance of their patches from the appearance subspace. The patches are sampled
+     * at VIDEOTRACKING_PCA_PATCH pixels square and projected onto the subspace's few components.
+     * @param frame Frame data
+     * @param particles Number of particles to be evaluated; the others get the lowest weight
+     */
+    void evaluate_pca(IplImage *frame, int particles);
+
+    /**
+     * Compares a box of the frame with the template the same way particleEvalDefault() does.
+     * @param frame Frame data
+     * @param position Position of the object; x and y are its center
+     * @return Root mean square difference of pixel values (0-255); 255 if the box is outside the frame
+     */
+    double get_template_error(IplImage *frame, Selection const &position) const;
+
 private:
     void *particle;
     IplImage* reference;
     CvSize resize;
     int pDyn;
+    double stdX; // Noise of x with a step of one frame
+    double stdY; // Noise of y with a step of one frame
+    double matchError;
+    int evaluatedParticles; // In the last tracked frame
+    double evaluationTime; // Of the last tracked frame; in milliseconds
+    double motionX; // Motion prior for the next frame
+    double motionY;
+    ForegroundMask const *foregroundMask; // Mask of the next frame
+    int prunedParticles;
+    bool faceMode;
+    SkinColorMap skinMap;
+    double referenceSkin; // Portion of skin color in the reference
+    CvPoint2D32f lastCenter; // Center of the last position
+    bool pcaModel;
+    cv::Mat pcaMean; // 1 x D mean patch
+    cv::Mat pcaEigenvectors; // M x D orthonormal basis of the appearance subspace
+
+    IplImage *referenceReduced; // Reference for evaluation at a reduced resolution
+    CvSize resizeReduced;
+    double timeBudget; // In milliseconds; 0 - no limit
+    double particleTime; // Average time of evaluating one particle; in milliseconds
+    double particleTimeReduced; // Average time of evaluating one particle at the reduced resolution
+    bool degraded;
 };
 
 #endif // TRACKINGALGORITHM_H
@@ -0,0 +1,17 @@
+/**
+ * @file trackingpreset.h
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#ifndef TRACKINGPRESET_H
+#define TRACKINGPRESET_H
+
+struct TrackingPreset
+{
+    static const unsigned FAST;
+    static const unsigned BALANCED;
+    static const unsigned ACCURATE;
+};
+
+#endif // TRACKINGPRESET_H
@@ -0,0 +1,136 @@
+/**
+ * @file trackingworker.h
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#ifndef TRACKINGWORKER_H
+#define TRACKINGWORKER_H
+
+#include "ffmpegplayer.h"
+#include "trackedobject.h"
+#include "videoframe.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define VIDEOTRACKING_LOOKAHEAD_TIME 10000 // How far ahead of the playhead objects are tracked; in milliseconds
+#define VIDEOTRACKING_WORKER_CHUNK 25 // Number of frames tracked for one object before switching to another one
+
+/**
+ * Tracks objects in a background thread ahead of the playhead. The worker has its own decoder;
+ * tracked objects are shared with VideoTracker and accessed only with objectsMutex locked.
+ */
+class TrackingWorker
+{
+public:
+    /**
+     * Constructor
+     * @param videoAddr Path to a video file
+     * @param analyzedPlayer Player with the same video already opened
+     * @param trackedObjects Tracked objects; accessed only with objectsMutex locked
+     * @param objectsMutex Mutex protecting tracked objects
+     */
+    TrackingWorker(std::string const &videoAddr, FFmpegPlayer const &analyzedPlayer,
+                   std::vector<std::shared_ptr<TrackedObject>> const &trackedObjects,
+                   std::recursive_mutex &objectsMutex);
+
+    /**
+     * Destructor; stops the worker.
+     */
+    ~TrackingWorker();
+
+    /**
+     * Starts the background thread.
+     */
+    void start();
+
+    /**
+     * Cancels the work and waits until the background thread finishes.
+     */
+    void stop();
+
+    /**
+     * Restarts the work; is called when the work done so far might have been invalidated
+     * by a change of trajectory sections.
+     */
+    void restart();
+
+    /**
+     * Sets the timestamp of the currently displayed frame.
+     * @param timestamp Timestamp
+     */
+    void set_playhead(int64_t timestamp);
+
+    /**
+     * Returns whether the background thread is running.
+     * @return True if running
+     */
+    bool is_running() const;
+
+    /**
+     * Sets the size of tracking frames. It may be called only when the worker is not running.
+     * @param width Frame width
+     * @param height Frame height
+     */
+    void set_frame_size(unsigned int width, unsigned int height);
+
+    /**
+     * Enables / disables foreground gating of the tracking frame. It may be called only when the worker is not running.
+     * @param enabled True if particles should be pruned by the foreground mask
+     */
+    void set_foreground_gating(bool enabled);
+
+    /**
+     * Enables / disables luma-only tracking frame. It may be called only when the worker is not running.
+     * @param enabled True if only luma should be used for tracking
+     */
+    void set_luma_only(bool enabled);
+
+    /**
+     * Enables / disables exporting of motion vectors by the worker's decoder. It may be called only when the worker
+     * is not running.
+     * @param enabled True if motion vectors should be exported
+     */
+    void set_motion_vectors(bool enabled);
+
+private:
+    /**
+     * Main loop of the background thread.
+     */
+    void run();
+
+    /**
+     * Tracks a chunk of frames of the object if the object is not tracked far enough ahead of the playhead.
+     * @param object Tracked object
+     * @return True if any frame was tracked
+     */
+    bool track_ahead(std::shared_ptr<TrackedObject> const &object);
+
+    /**
+     * Returns whether the current work should be interrupted.
+     * @return True if stop or restart was requested
+     */
+    bool interrupted() const;
+
+private:
+    FFmpegPlayer player;
+    VideoFrame frame;
+    bool frameValid; // Frame contains the last frame read by the player
+
+    std::vector<std::shared_ptr<TrackedObject>> const &trackedObjects;
+    std::recursive_mutex &objectsMutex;
+
+    std::thread thread;
+    std::mutex stateMutex;
+    std::condition_variable stateChanged;
+    std::atomic<bool> stopRequested;
+    std::atomic<bool> restartRequested;
+    std::atomic<int64_t> playhead;
+};
+
+#endif // TRACKINGWORKER_H
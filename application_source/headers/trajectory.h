@@ -0,0 +1,352 @@
+/**
+ * @file trajectory.h
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "trackingalgorithm.h"
+#include "selection.h"
+
+#include <cereal/types/map.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <stdint.h> // uint16_t; needed for MSVC compiler
+
+#define VIDEOTRACKING_LOW_CONFIDENCE_ERROR 30.0 // Positions tracked with a higher matching error are of low confidence
+#define VIDEOTRACKING_TRAJECTORY_CHANGES_MAX 65536 // Changes kept for get_changes(); older versions need the whole trajectory
+
+struct TrajectoryEntry
+{
+    // CEREAL serialization; project format 1 adds interpolated, degraded and the telemetry
+    template<class Archive>
+    void serialize(Archive &archive)
+    {
+        archive(CEREAL_NVP(position), CEREAL_NVP(timePosition), CEREAL_NVP(frameNumber));
+        if (ProjectFormat::get() >= 1)
+            archive(CEREAL_NVP(interpolated), CEREAL_NVP(degraded), CEREAL_NVP(matchError), CEREAL_NVP(particles),
+                    CEREAL_NVP(prunedParticles), CEREAL_NVP(evaluationTime));
+    }
+
+    /**
+     * Constructor
+     */
+    TrajectoryEntry() : interpolated(false), degraded(false), matchError(0), particles(0), prunedParticles(0), evaluationTime(0) { }
+
+    /**
+     * Constructor
+     * @param position Object position
+     * @param timePosition
+     * @param frameNumber
+     * @param interpolated Position was interpolated, not tracked
+     * @param degraded Position was tracked with reduced quality
+     */
+    TrajectoryEntry(Selection position, unsigned long timePosition, unsigned long frameNumber, bool interpolated=false,
+                    bool degraded=false) :
+        position(position),
+        timePosition(timePosition),
+        frameNumber(frameNumber),
+        interpolated(interpolated),
+        degraded(degraded),
+        matchError(0),
+        particles(0),
+        prunedParticles(0),
+        evaluationTime(0)
+    { }
+
+    /**
+     * Stores the quality and cost of tracking the last frame.
+     * @param trackingAlgorithm Algorithm that tracked the position
+     */
+    void set_telemetry(TrackingAlgorithm const &trackingAlgorithm)
+    {
+        matchError = trackingAlgorithm.get_match_error();
+        particles = std::min(trackingAlgorithm.get_evaluated_particles(), static_cast<int>(UINT16_MAX));
+        prunedParticles = std::min(trackingAlgorithm.get_pruned_particles(), static_cast<int>(UINT16_MAX));
+        evaluationTime = trackingAlgorithm.get_evaluation_time();
+    }
+
+    /**
+     * Returns whether the position was tracked with a high matching error.
+     * @return True if of low confidence
+     */
+    bool is_low_confidence() const
+    {
+        return particles > 0 && matchError > VIDEOTRACKING_LOW_CONFIDENCE_ERROR;
+    }
+
+    Selection position;
+    unsigned long timePosition;
+    unsigned long frameNumber;
+    bool interpolated; // Frame was skipped by sparse tracking
+    bool degraded; // Frame was tracked with reduced quality to meet a time budget
+    float matchError; // Of the best particle; 0 if the position was not tracked by particles
+    uint16_t particles; // Number of evaluated particles; 0 if the position was not tracked by particles
+    uint16_t prunedParticles; // Particles skipped by foreground gating
+    float evaluationTime; // Time of evaluating the particles; in milliseconds
+
+};
+
+/**
+ * Computed trajectory of an object. Entries are stored contiguously and indexed by their frame number,
+ * so the trajectory is iterated and searched like std::map<int64_t, TrajectoryEntry> without allocating
+ * a node per frame. Frames missing in the middle of the trajectory are kept as invalid slots holding
+ * the timestamp of the preceding entry so the timestamps stay sorted for a binary search.
+ * Changes of entries are versioned, so readers can follow the trajectory without reading it whole.
+ */
+class Trajectory
+{
+public:
+    typedef int64_t key_type;
+    typedef TrajectoryEntry mapped_type;
+    typedef std::pair<int64_t, TrajectoryEntry> value_type;
+
+    /**
+     * Bidirectional iterator over the valid entries.
+     */
+    template<class Value, class Slots>
+    class Iterator : public std::iterator<std::bidirectional_iterator_tag, Value>
+    {
+    public:
+        Iterator() : slots(nullptr), valid(nullptr), index(0) { }
+
+        /**
+         * Converts a mutable iterator to a constant one.
+         */
+        template<class OtherValue, class OtherSlots>
+        Iterator(Iterator<OtherValue, OtherSlots> const &other) :
+            slots(other.slots), valid(other.valid), index(other.index) { }
+
+        Value &operator*() const { return (*slots)[index]; }
+        Value *operator->() const { return &(*slots)[index]; }
+
+        Iterator &operator++()
+        {
+            do
+                index++;
+            while (index < valid->size() && !(*valid)[index]);
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        Iterator &operator--()
+        { // The first slot is always valid
+            do
+                index--;
+            while (!(*valid)[index]);
+            return *this;
+        }
+
+        Iterator operator--(int)
+        {
+            Iterator previous = *this;
+            --(*this);
+            return previous;
+        }
+
+        bool operator==(Iterator const &other) const { return index == other.index; }
+        bool operator!=(Iterator const &other) const { return index != other.index; }
+
+    private:
+        template<class, class> friend class Iterator;
+        friend class Trajectory;
+
+        Iterator(Slots *slots, std::vector<bool> const *valid, size_t index) :
+            slots(slots), valid(valid), index(index) { }
+
+        Slots *slots;
+        std::vector<bool> const *valid;
+        size_t index;
+    };
+
+    typedef Iterator<value_type, std::vector<value_type>> iterator;
+    typedef Iterator<value_type const, std::vector<value_type> const> const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    /**
+     * CEREAL serialization; the format is the same as of std::map<int64_t, TrajectoryEntry>
+     */
+    template<class Archive>
+    void save(Archive &archive) const
+    {
+        cereal::map_detail::save(archive, *this);
+    }
+
+    /**
+     * CEREAL deserialization
+     */
+    template<class Archive>
+    void load(Archive &archive)
+    {
+        cereal::map_detail::load(archive, *this);
+    }
+
+    /**
+     * Constructor
+     */
+    Trajectory();
+
+    /**
+     * Sets the entry of a frame. The slot is chosen by entry.frameNumber.
+     * @param timestamp Timestamp of the frame
+     * @param entry
+     * @return Stored entry
+     */
+    TrajectoryEntry &set(int64_t timestamp, TrajectoryEntry const &entry);
+
+    /**
+     * Sets the entry of a frame; used by CEREAL when loading.
+     * @param hint Ignored
+     * @param timestamp Timestamp of the frame
+     * @param entry
+     * @return Iterator to the stored entry
+     */
+    iterator emplace_hint(const_iterator hint, int64_t timestamp, TrajectoryEntry entry);
+
+    /**
+     * Records a change of an entry that was modified through an iterator.
+     * @param timestamp Timestamp of the entry
+     */
+    void touch(int64_t timestamp);
+
+    /**
+     * Makes readers following the changes read the whole trajectory again.
+     */
+    void invalidate();
+
+    /**
+     * Returns the version of the trajectory. It increases with every change and is unique among all trajectories.
+     * @return Version
+     */
+    unsigned long get_version() const;
+
+    /**
+     * Returns timestamps of entries that were added or changed since a version.
+     * @param version Version seen by the caller
+     * @param timestamps Returned timestamps; sorted and unique
+     * @return False if entries were erased since the version or the version is too old; the whole trajectory
+     * needs to be read again
+     */
+    bool get_changes(unsigned long version, std::vector<int64_t> &timestamps) const;
+
+    /**
+     * Erases entries in range [first, last).
+     * @param first
+     * @param last
+     */
+    void erase(const_iterator first, const_iterator last);
+
+    /**
+     * Erases all entries.
+     */
+    void clear();
+
+    /**
+     * Returns the number of entries.
+     * @return Number of entries
+     */
+    size_t size() const { return count; }
+
+    /**
+     * Returns whether there is no entry.
+     * @return True if empty
+     */
+    bool empty() const { return count == 0; }
+
+    iterator begin() { return iterator(&slots, &valid, 0); }
+    iterator end() { return iterator(&slots, &valid, slots.size()); }
+    const_iterator begin() const { return const_iterator(&slots, &valid, 0); }
+    const_iterator end() const { return const_iterator(&slots, &valid, slots.size()); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    /**
+     * Finds the entry with given timestamp.
+     * @param timestamp
+     * @return Iterator to the entry; end() if not found
+     */
+    iterator find(int64_t timestamp) { return iterator(&slots, &valid, find_index(timestamp)); }
+    const_iterator find(int64_t timestamp) const { return const_iterator(&slots, &valid, find_index(timestamp)); }
+
+    /**
+     * Returns the first entry with timestamp not lower than given timestamp.
+     * @param timestamp
+     * @return Iterator to the entry; end() if there is none
+     */
+    iterator lower_bound(int64_t timestamp) { return iterator(&slots, &valid, lower_index(timestamp)); }
+    const_iterator lower_bound(int64_t timestamp) const { return const_iterator(&slots, &valid, lower_index(timestamp)); }
+
+    /**
+     * Returns the first entry with timestamp higher than given timestamp.
+     * @param timestamp
+     * @return Iterator to the entry; end() if there is none
+     */
+    iterator upper_bound(int64_t timestamp) { return iterator(&slots, &valid, upper_index(timestamp)); }
+    const_iterator upper_bound(int64_t timestamp) const { return const_iterator(&slots, &valid, upper_index(timestamp)); }
+
+private:
+    /**
+     * Finds the slot of the entry with given timestamp. The slot is first estimated from the frame rate
+     * of the stored entries, which is exact for videos with a constant frame rate.
+     * @param timestamp
+     * @return Index of the slot; slots.size() if not found
+     */
+    size_t find_index(int64_t timestamp) const;
+
+    /**
+     * Returns the first slot with timestamp not lower than given timestamp.
+     * @param timestamp
+     * @return Index of the slot; slots.size() if there is none
+     */
+    size_t lower_index(int64_t timestamp) const;
+
+    /**
+     * Returns the first slot with timestamp higher than given timestamp.
+     * @param timestamp
+     * @return Index of the slot; slots.size() if there is none
+     */
+    size_t upper_index(int64_t timestamp) const;
+
+    /**
+     * Removes invalid slots from both ends so the first and the last slot are always valid.
+     */
+    void trim();
+
+    /**
+     * Records a change of an entry with a new version.
+     * @param timestamp Timestamp of the entry
+     */
+    void record_change(int64_t timestamp);
+
+    /**
+     * Returns a new version, higher than any version returned before.
+     * @return Version
+     */
+    static unsigned long new_version();
+
+    std::vector<value_type> slots; // Indexed by frame number - firstFrameNumber
+    std::vector<bool> valid; // Whether the slot contains an entry
+    unsigned long firstFrameNumber;
+    size_t count; // Number of valid slots
+    std::vector<std::pair<unsigned long, int64_t>> changes; // Versions and timestamps of changed entries since resetVersion
+    unsigned long resetVersion; // Entries were erased or the older changes dropped in this version
+
+    static std::atomic<unsigned long> lastVersion;
+};
+
+#endif // TRAJECTORY_H
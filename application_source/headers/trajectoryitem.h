@@ -30,9 +30,11 @@ public:
      * @param frameCount Number of frames in the video
      * @param parent Parent widget
      * @param displayTime True - display time. False - display frame number
+     * @param interpolated True - position was interpolated, not tracked
+     * @param lowConfidence True - position was tracked with a high matching error; it is highlighted
      */
     TrajectoryItem(int64_t timestamp, unsigned long timePosition, unsigned long totalTime, unsigned long frameNumber, unsigned long frameCount,
-                   Selection position, QWidget *parent, bool displayTime=false);
+                   Selection position, QWidget *parent, bool displayTime=false, bool interpolated=false, bool lowConfidence=false);
 
     /**
      * Destructor
@@ -45,6 +47,12 @@ public:
      */
     int64_t get_timestamp() const;
 
+    /**
+     * Returns whether the position was interpolated.
+     * @return True if interpolated
+     */
+    bool is_interpolated() const;
+
     /**
      * Displays values as time positions.
      */
@@ -71,6 +79,7 @@ private:
     unsigned long timePosition;
     unsigned long frameNumber;
     bool isSet;
+    bool interpolated;
     QVBoxLayout *vLayout;
     const QString backgroundColorActive = "background-color: rgb(115, 171, 230);";
     const QString backgroundColorInactive = "background-color: rgb(255, 255, 255);";
@@ -12,14 +12,22 @@
 #include <cxcore.h>
 #include <highgui.h>
 
+#include "selection.h"
+#include "foregroundmask.h"
+#include "imagepool.h"
+
+#include <vector>
+
 extern "C"{
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
+#include <libavutil/motion_vector.h>
 }
 
 #define VIDEOTRACKING_DEFAULT_SCALING_METHOD SWS_BILINEAR
 #define VIDEOTRACKING_OUTPUT_FORMAT AV_PIX_FMT_YUV420P
+#define VIDEOTRACKING_REGION_CONVERSION_MAX 0.5 // Larger conversion regions (relative to the frame area) are not worth it
 
 class VideoFrame
 {
@@ -47,12 +55,19 @@ public:
     ~VideoFrame();
 
     /**
-     * Sets a new frame
+     * Sets a new frame; it is scaled to the size of this frame.
      * @param newFrame New frame data
      * @return True if successful
      */
     bool set_frame(AVFrame const *newFrame);
 
+    /**
+     * Sets a new frame scaled from another frame to the size of this frame.
+     * @param source Source frame
+     * @return True if successful
+     */
+    bool set_scaled_frame(VideoFrame const &source);
+
     unsigned long get_time_position() const;
     /**
      * Returns frame timestamp.
@@ -78,6 +93,117 @@ public:
      */
     unsigned int get_height() const;
 
+    /**
+     * Returns the median motion of the blocks inside a region since the reference frame,
+     * taken from the motion vectors exported by the decoder.
+     * @param region Region in source coordinates
+     * @param dx Returned horizontal motion in source pixels
+     * @param dy Returned vertical motion in source pixels
+     * @return False if there are no motion vectors in the region
+     */
+    bool get_motion(cv::Rect const &region, double &dx, double &dy) const;
+
+    /**
+     * Limits conversion of the decoded picture to a region. Frames that are used only for tracking
+     * need just the surroundings of the tracked objects; the rest of the frame keeps old data.
+     * The foreground mask is computed from the whole decoded luma plane; if the picture does not
+     * have one, the whole frame is converted while gating is enabled.
+     * @param region Region in source coordinates; an empty region - the whole frame is converted
+     */
+    void set_conversion_region(cv::Rect const &region);
+
+    /**
+     * Enables / disables decode-only frames. The picture of a decode-only frame is not converted at all;
+     * the frame keeps its former contents. Intended for frames that are read only to reach the next one.
+     * @param enabled True if pictures should only be decoded
+     */
+    void set_decode_only(bool enabled);
+
+    /**
+     * Enables / disables computing of the foreground mask. The mask needs continuous frames,
+     * so it should be enabled for frames that are reused for reading consecutive frames.
+     * @param enabled True if the mask should be computed
+     */
+    void set_foreground_gating(bool enabled);
+
+    /**
+     * Returns the foreground mask of this frame. It is computed once per frame, when it is needed
+     * for the first time, and is shared by all objects tracked in the frame.
+     * @return Mask; nullptr if gating is disabled or the mask is not valid for this frame
+     */
+    ForegroundMask const *get_foreground_mask() const;
+
+    /**
+     * Enables / disables luma-only frames. Luma-only frames are single-channel; the luma plane of
+     * a YUV picture is copied without any color conversion. Intended for frames used only for tracking.
+     * @param enabled True if only luma should be stored
+     */
+    void set_luma_only(bool enabled);
+
+    /**
+     * Returns whether the frame stores only luma.
+     * @return True if luma-only
+     */
+    bool is_luma_only() const;
+
+    /**
+     * Enables / disables YUV-only frames. YUV-only frames keep the decoded picture in the output
+     * pixel format and have no cv::Mat; marks are drawn directly into the planes.
+     * Intended for frames that are only encoded.
+     * @param enabled True if only the YUV picture should be stored
+     */
+    void set_yuv_only(bool enabled);
+
+    /**
+     * Returns cv::Mat headers of the planes of a YUV-only frame. The data are shared with the frame;
+     * chroma planes are subsampled.
+     * @param planes Returned planes; Y, U and V
+     * @return False if the frame is not YUV-only or does not contain a picture
+     */
+    bool get_planes(std::vector<cv::Mat> &planes);
+
+    /**
+     * Sets the size of a display image that is converted from each decoded picture along with the frame.
+     * The picture is scaled directly to the display size, so frames shown in QT are not converted at
+     * the full resolution. The cv::Mat of such frames is converted only when it is read.
+     * @param pool Pool providing buffers of the display images; nullptr - no display image is converted
+     * @param displayWidth Width of the display image
+     * @param displayHeight Height of the display image
+     */
+    void set_display_size(ImagePool *pool, unsigned int displayWidth, unsigned int displayHeight);
+
+    /**
+     * Returns the display image of the current picture.
+     * @return RGB32 image; null if no picture was converted yet
+     */
+    QImage get_display_image() const;
+
+    /**
+     * Returns width of the decoded video; differs from the frame width when the frame is scaled.
+     * @return Source width
+     */
+    unsigned int get_source_width() const;
+
+    /**
+     * Returns height of the decoded video; differs from the frame height when the frame is scaled.
+     * @return Source height
+     */
+    unsigned int get_source_height() const;
+
+    /**
+     * Maps a position in the decoded video to the coordinates of this frame.
+     * @param position Position in source coordinates
+     * @return Position in frame coordinates
+     */
+    Selection to_frame_coordinates(Selection const &position) const;
+
+    /**
+     * Maps a position in this frame to the coordinates of the decoded video.
+     * @param position Position in frame coordinates
+     * @return Position in source coordinates
+     */
+    Selection to_source_coordinates(Selection const &position) const;
+
     /**
      * Sets frame size.
      * @param newWidth New frame width
@@ -110,7 +236,7 @@ public:
     AVFrame const *get_av_frame();
 
     /**
-     * Returns the frame in cv::Mat.
+     * Returns the frame in cv::Mat. The picture of a displayed frame is converted when it is read for the first time.
      * @return Frame
      */
     cv::Mat const *get_mat_frame() const;
@@ -123,6 +249,57 @@ public:
      */
     bool AVFrame2Mat(AVFrame const *src, cv::Mat *dstMat) const;
 
+    /**
+     * Converts a region of AVFrame to the corresponding region of cv::Mat.
+     * @param src Source AVFrame
+     * @param dstMat Destination cv::Mat; It mus be allocated before using this function.
+     * @param region Region of the source AVFrame
+     * @return True if successful
+     */
+    bool AVFrame2MatRegion(AVFrame const *src, cv::Mat *dstMat, cv::Rect region) const;
+
+    /**
+     * Converts AVFrame to the display image; it is scaled to the display size.
+     * @param src Source AVFrame
+     * @return True if successful
+     */
+    bool AVFrame2Display(AVFrame const *src);
+
+    /**
+     * Converts AVFrame to matFrame; only the conversion region is converted and luma-only frames copy the luma plane.
+     * @param src Source AVFrame
+     * @return True if successful
+     */
+    bool convert_frame(AVFrame const *src) const;
+
+    /**
+     * Copies (a region of) the luma plane of AVFrame to the corresponding region of single-channel cv::Mat.
+     * @param src Source AVFrame; its format must have an 8-bit luma plane
+     * @param dstMat Destination cv::Mat; It mus be allocated before using this function.
+     * @param region Region of the source AVFrame; an empty region - the whole plane is copied
+     * @return True if successful
+     */
+    bool Luma2Mat(AVFrame const *src, cv::Mat *dstMat, cv::Rect region) const;
+
+    /**
+     * Allocates avFrame in the output format and size of the frame.
+     * @return True if successful
+     */
+    bool allocate_av_frame();
+
+    /**
+     * Checks whether the first plane of a pixel format is 8-bit luma that can be used directly.
+     * @param format Pixel format
+     * @return True if the luma plane can be used
+     */
+    bool has_luma_plane(int format) const;
+
+    /**
+     * Downsamples the whole luma plane of AVFrame for the foreground mask.
+     * @param src Source AVFrame
+     */
+    void set_foreground_luma(AVFrame const *src);
+
     /**
      * Converts cv::Mat to AVFrame.
      * @param src Source cv::at
@@ -144,6 +321,21 @@ private:
     unsigned long frameNumber;
     unsigned int width;
     unsigned int height;
+    unsigned int sourceWidth;
+    unsigned int sourceHeight;
+    cv::Rect conversionRegion; // Empty - the whole frame is converted
+    std::vector<AVMotionVector> motionVectors; // Exported by the decoder; empty for intra frames
+    ForegroundMask *foregroundMask; // nullptr - gating is disabled
+    cv::Mat foregroundLuma; // Downsampled luma of the whole decoded picture; empty - the mask is computed from matFrame
+    bool lumaOnly;
+    bool decodeOnly; // Pictures are not converted
+    bool yuvOnly; // Picture is stored only in avFrame
+    ImagePool *displayPool; // nullptr - no display image
+    unsigned int displayWidth;
+    unsigned int displayHeight;
+    QImage displayImage;
+    AVFrame *decodedFrame; // Picture of a displayed frame; matFrame is converted from it when it is read
+    mutable bool matPending; // matFrame was not converted from decodedFrame yet
 
 };
 
@@ -17,16 +17,28 @@
 #include <QApplication>
 
 #include <memory>
+#include <mutex>
 
 #include "ffmpegplayer.h"
+#include "framecache.h"
+#include "imagepool.h"
+#include "markcompositor.h"
 #include "trackingalgorithm.h"
 #include "trackedobject.h"
+#include "trackingworker.h"
 #include "videoframe.h"
 #include "selection.h"
+#include "objectdetector.h"
 
 #include <cereal/types/vector.hpp>
 #include <cereal/types/memory.hpp> // for shared_ptr
 
+#define VIDEOTRACKING_BACKWARD_BUFFER 30 // Maximal number of frames decoded at once when tracking backward
+#define VIDEOTRACKING_BACKWARD_MAX_ERROR 40.0 // Matching error at which tracking backward from the Beginning stops
+#define VIDEOTRACKING_DETECTION_MIN_OVERLAP 0.2 // Detection belongs to an object if their boxes overlap at least this much (IoU)
+#define VIDEOTRACKING_DETECTION_CONFIRM_OVERLAP 0.5 // Tracked position agreeing this much with the detection is kept
+#define VIDEOTRACKING_DETECTION_MAX_MISSES 2 // Object ends when it is not detected this many times in a row
+
 struct OutputException : public std::exception{};
 struct UserCanceledException : public std::exception{};
 
@@ -38,7 +50,10 @@ public:
     template<class Archive>
     void serialize(Archive &archive)
     {
+        std::lock_guard<std::recursive_mutex> lock(objectsMutex);
         archive(CEREAL_NVP(trackedObjects));
+        objectsRevision = TrackedObject::new_revision(); // Loaded objects replace the current ones
+        cachedVersions.clear();
     }
 
     /**
@@ -65,6 +80,75 @@ public:
      */
     void load_video(std::string const &videoAddr, QProgressDialog const *progressDialog);
 
+    /**
+     * Starts tracking objects in the background ahead of the currently displayed frame.
+     */
+    void start_background_tracking();
+
+    /**
+     * Stops the background tracking.
+     */
+    void stop_background_tracking();
+
+    /**
+     * Sets time budget for tracking all objects in a frame during playback. Frames that do not fit
+     * into the budget are tracked with reduced quality and tracked again before the output is created.
+     * @param budget Time budget in milliseconds; 0 - no limit, full quality
+     */
+    void set_tracking_budget(double budget);
+
+    /**
+     * Sets the resolution of frames used for tracking. Frames are scaled down already when converted
+     * from the decoded picture; tracked positions are mapped back to the video coordinates.
+     * Sections being tracked are tracked again from their beginning.
+     * @param maxHeight Maximal height of tracking frames; 0 - original resolution
+     */
+    void set_tracking_resolution(unsigned int maxHeight);
+
+    /**
+     * Enables / disables foreground gating. A cheap foreground mask is computed once per frame
+     * and particles whose boxes contain almost no foreground are not evaluated.
+     * @param enabled True if gating should be used
+     */
+    void set_foreground_gating(bool enabled);
+
+    /**
+     * Enables / disables the motion prior. The decoders then export motion vectors, and particles are shifted
+     * by the median motion inside the object's box before they are evaluated. Frames without motion vectors
+     * are tracked without the prior.
+     * @param enabled True if motion vectors should be used in tracking
+     */
+    void set_motion_prior(bool enabled);
+
+    /**
+     * Enables / disables luma-only tracking. Tracking frames then store only the luma plane of the decoded
+     * picture, which is copied without color conversion; particles are scored on 8-bit luma.
+     * Sections being tracked are tracked again from their beginning.
+     * @param enabled True if only luma should be used for tracking
+     */
+    void set_luma_tracking(bool enabled);
+
+    /**
+     * Sets the size of the viewport frames are displayed in. Displayed frames are scaled to fit it
+     * already when converted from the decoded picture; tracking keeps its own resolution.
+     * @param width Viewport width; 0 - frames are displayed at the video size
+     * @param height Viewport height
+     * @return True if the size of displayed frames has changed
+     */
+    bool set_preview_size(unsigned int width, unsigned int height);
+
+    /**
+     * Returns width of the video.
+     * @return Video width
+     */
+    unsigned int get_width() const;
+
+    /**
+     * Returns height of the video.
+     * @return Video height
+     */
+    unsigned int get_height() const;
+
     /**
      * Returns frames per second value of the video.
      * @return Frames per second
@@ -214,6 +298,13 @@ public:
     void create_output(std::string const &filename, QProgressDialog &fileProgressDialog,
                        QProgressDialog *trackingProgressDialog, std::string inFileExtension);
 
+    /**
+     * Returns how marks were drawn into the last created output.
+     * @param frames Returned number of frames the marks were drawn into
+     * @param averageTime Returned average time of drawing marks into a frame; in milliseconds
+     * @param tiles Returned number of tiles the last plane was split into
+     */
+    void get_output_statistics(unsigned long &frames, double &averageTime, unsigned int &tiles) const;
 
     /**
      * Returns appearance of the object.
@@ -223,18 +314,45 @@ public:
     Characteristics get_object_appearance(unsigned int objectID) const;
 
     /**
-     * Returns trajectory sections of the object.
+     * Returns a copy of trajectory sections of the object.
+     * A copy is returned as the object might be tracked in the background.
      * @param objectID Object ID
      * @return Trajectory section of the object
      */
-    std::map<int64_t, TrajectorySection> const &get_object_trajectory_sections(unsigned int objectID) const;
+    std::map<int64_t, TrajectorySection> get_object_trajectory_sections(unsigned int objectID) const;
 
     /**
-     * Returns computed trajectory of the object.
+     * Returns a copy of computed trajectory of the object.
+     * A copy is returned as the object might be tracked in the background.
      * @param objectID Object ID
      * @return Trajectory of the object
      */
-    std::map<int64_t, TrajectoryEntry> const &get_object_trajectory(unsigned int objectID) const;
+    std::map<int64_t, TrajectoryEntry> get_object_trajectory(unsigned int objectID) const;
+
+    /**
+     * Returns entries of the trajectory of the object that were added or changed since a version,
+     * so the trajectory can be followed without copying it whole.
+     * @param objectID Object ID
+     * @param version Version of the trajectory seen by the caller; 0 - none. Returned the current version
+     * @param entries Returned entries; sorted by timestamp
+     * @return False if entries were erased since the version; entries then contain the whole trajectory
+     */
+    bool get_object_trajectory_changes(unsigned int objectID, unsigned long &version,
+                                       std::vector<std::pair<int64_t, TrajectoryEntry>> &entries) const;
+
+    /**
+     * Summarizes the quality and cost of tracking the object over the frames tracked so far.
+     * Interpolated positions and positions not tracked by particles are not counted.
+     * @param objectID Object ID
+     * @param averageError Returned average matching error of the best particle
+     * @param averageParticles Returned average number of evaluated particles
+     * @param averagePruned Returned average number of particles skipped by foreground gating
+     * @param averageTime Returned average time of evaluating the particles in a frame; in milliseconds
+     * @param lowConfidence Returned number of frames tracked with low confidence
+     * @return False if no frame of the object has been tracked yet
+     */
+    bool get_object_telemetry(unsigned int objectID, double &averageError, double &averageParticles,
+                              double &averagePruned, double &averageTime, unsigned int &lowConfidence) const;
 
     /**
      * Changes appearance of the object.
@@ -260,6 +378,23 @@ public:
      */
     bool get_object_end(unsigned int objectID, int64_t &timestamp, unsigned long &timePosition, unsigned long &frameNumber);
 
+    /**
+     * Return information about the scene cut tracking of the object ended at.
+     * @param objectID Object ID
+     * @param timestamp First frame of the new scene
+     * @param timePosition Time position
+     * @param frameNumber Frame number (index)
+     * @return True if tracking ended at a scene cut, false if it did not.
+     */
+    bool get_object_scene_cut(unsigned int objectID, int64_t &timestamp, unsigned long &timePosition, unsigned long &frameNumber) const;
+
+    /**
+     * Ignores the scene cut tracking of the object ended at; the object is tracked further.
+     * @param objectID Object ID
+     * @return True if successful
+     */
+    bool ignore_object_scene_cut(unsigned int objectID);
+
      /**
      * Changes a trajectory section of the object.
      * @param objectID Object ID
@@ -330,6 +465,34 @@ public:
      */
     void delete_object(unsigned int objectID);
 
+    /**
+     * Sets the tracking stride of the object; only every n-th frame is tracked.
+     * @param objectID Object ID
+     * @param stride Track every n-th frame
+     */
+    void set_object_tracking_stride(unsigned int objectID, unsigned int stride);
+
+    /**
+     * Returns the tracking stride of the object.
+     * @param objectID Object ID
+     * @return Every n-th frame is tracked
+     */
+    unsigned int get_object_tracking_stride(unsigned int objectID) const;
+
+    /**
+     * Sets tracking parameters of the object; the trajectory is computed again with them.
+     * @param objectID Object ID
+     * @param parameters Tracking parameters
+     */
+    void set_object_tracking_parameters(unsigned int objectID, TrackingParameters const &parameters);
+
+    /**
+     * Returns tracking parameters of the object.
+     * @param objectID Object ID
+     * @return Tracking parameters
+     */
+    TrackingParameters get_object_tracking_parameters(unsigned int objectID) const;
+
     /**
      * Computes all trajectory for the tracked object
      * @param objectID ObjectID
@@ -338,6 +501,37 @@ public:
      */
     bool track_object(unsigned int objectID, QProgressDialog *progressDialog);
 
+    /**
+     * Detects objects on keyframes or on every n-th frame; the objects are tracked in between.
+     * A detection overlapping an object created by the detection either confirms its tracked position
+     * or begins a new trajectory section; other detections create new objects. An object that is not
+     * detected anymore ends at the first frame it was missed at. Created objects are tracked in the background
+     * while the detection continues.
+     * Throws UserCanceledException when user clicked "Cancel" button in the progress dialog;
+     * the objects created so far are kept.
+     * @param detector Object detector; it also measures the time of detection
+     * @param interval Detection runs on every n-th frame; 0 - on keyframes only
+     * @param appearance Appearance of created objects
+     * @param namePrefix Created objects are named by the prefix and a number
+     * @param progressDialog QT progress dialog for showing an information about the detection process
+     * @return Number of created objects
+     */
+    int detect_objects(ObjectDetector &detector, unsigned int interval, Characteristics const &appearance,
+                       std::string const &namePrefix, QProgressDialog *progressDialog);
+
+    /**
+     * Tracks the object backward from the beginning of a trajectory section. Tracking from the Beginning
+     * goes until the object cannot be found anymore; tracking from a trajectory change goes until
+     * the middle between this and the previous section, where it meets the forward tracking.
+     * Throws UserCanceledException when user clicked "Cancel" button in the progress dialog;
+     * the frames tracked so far are kept.
+     * @param objectID Object ID
+     * @param sectionTimestamp Initial timestamp of the section
+     * @param progressDialog QT progress dialog for showing an information about tracking object process
+     * @return True if successful
+     */
+    bool track_object_backward(unsigned int objectID, int64_t sectionTimestamp, QProgressDialog *progressDialog);
+
     /**
      * Erases a part of the computed trajectory. This is necessary after deserialization (with CEREAL)
      * as track_next() initializes correct sections only when the trajectory's last frame is the last
@@ -348,25 +542,96 @@ public:
 
 private:
     /**
-     * Converts cv::Mat format (OpenCV frame) to QImage (QT)
-     * @param src Source frame in cv::Mat
-     * @return Frame for QT
+     * Returns how much two positions overlap.
+     * @param first First position; x and y is the top left corner
+     * @param second Second position; x and y is the top left corner
+     * @return Intersection over union; 0 - no overlap, 1 - the same positions
+     */
+    double get_overlap(Selection const &first, Selection const &second) const;
+
+    /**
+     * Returns the frame for tracking. It is the given frame or its copy scaled to the tracking resolution.
+     * @param frame Frame at the original resolution
+     * @return Frame at the tracking resolution
      */
-    QImage Mat2QImage(cv::Mat const &src) const;
+    VideoFrame const *get_tracking_frame(VideoFrame const *frame);
 
     // previousTimestamp can be used only when previousTimestampSet==true
 
     /**
 
-     * Draws tracking mark to the result cv::Mat. If current frame was not yet processed, processes tracking till this frame.
+     * Adds tracking marks of a frame to the compositor. If current frame was not yet processed, processes tracking till this frame.
      * @param originalFrame Original frame
-     * @param result Altered frame; with drawn tracked objects
      * @param progressDialog QT progress dialog for showing an information about tracking objects process
      * @param previousTimestampSet Used only with get_next_frame(). True - this is the following frame to the one given the last time.
      * @param previousTimestamp Timestamp of the preceding frame. This is used only if previousTimestampSet==true.
      * @return Returns true if successful
      */
-    bool track_frame(VideoFrame const *originalFrame, cv::Mat &result, QProgressDialog *progressDialog=nullptr, bool previousTimestampSet=false, int64_t previousTimestamp=0);
+    bool track_frame(VideoFrame const *originalFrame, QProgressDialog *progressDialog=nullptr, bool previousTimestampSet=false, int64_t previousTimestamp=0);
+
+    /**
+     * Draws tracking marks to the current frame, converts it to be displayed in QT and stores it in the frame cache.
+     * @param imgFrame Altered frame converted to be displayed in QT
+     * @param originalImgFrame Current frame converted to be displayed in QT
+     * @param includeOriginal Should be original frame converted?
+     * @param progressDialog QT progress dialog for showing an information about tracking objects process
+     * @param previousTimestampSet See track_frame()
+     * @param previousTimestamp See track_frame()
+     * @return True if successful
+     */
+    bool render_current_frame(QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal, QProgressDialog *progressDialog,
+                              bool previousTimestampSet=false, int64_t previousTimestamp=0);
+
+    /**
+     * Returns a frame from the frame cache and makes it the current frame. The frame is not decoded.
+     * @param timestamp Timestamp of the frame
+     * @param imgFrame Altered frame converted to be displayed in QT
+     * @param originalImgFrame Frame converted to be displayed in QT
+     * @param includeOriginal Is the original frame needed?
+     * @return True if the frame was cached
+     */
+    bool get_cached_frame(int64_t timestamp, QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal);
+
+    /**
+     * Decodes the current frame if it was returned from the frame cache, so the player can move from it.
+     * @return True if successful
+     */
+    bool decode_current_frame();
+
+    /**
+     * Tracks a new object in a frame that is already decoded.
+     * @param newObject New object
+     * @param initialFrame Frame at the initial timestamp of the object; it need not be read by the main player
+     * @return Object ID
+     */
+    int add_object(std::shared_ptr<TrackedObject> const &newObject, VideoFrame const *initialFrame);
+
+    /**
+     * Sets the size of display images converted from decoded pictures of the current frame.
+     * @param width Width of the display images
+     * @param height Height of the display images
+     */
+    void set_display_size(unsigned int width, unsigned int height);
+
+    /**
+     * Returns the revision of all objects. It changes whenever any frame may be drawn differently.
+     * @return Revision
+     */
+    unsigned long get_render_revision() const;
+
+    /**
+     * Removes frames whose positions changed since they were cached, e.g. interpolated skipped frames.
+     * Such changes do not change the revision of the objects.
+     */
+    void remove_changed_frames();
+
+    /**
+     * Draws marks of the objects directly into the planes of a YUV-only frame. Positions need to be
+     * already tracked. Frames without any object, or whose objects have no position in them, are not touched.
+     * @param frame YUV-only frame
+     * @return False if the marks could not be drawn into the frame
+     */
+    bool draw_marks(VideoFrame *frame);
 
     /**
      * Tracks all frames. This is called when an output media file is being created.
@@ -378,11 +643,27 @@ private:
 private:
     QApplication *qApplication; // Is used for updating progress bars
     std::shared_ptr<TrackedObject> a;
+    std::string videoAddress;
     FFmpegPlayer *player;
     VideoFrame *currentFrame;
-    VideoFrame *tempFrame;
+    VideoFrame *tempFrame; // Has the tracking resolution
+    VideoFrame *trackingFrame; // Current frame scaled to the tracking resolution
+    TrackingWorker *worker; // Tracks objects in the background
+    double trackingBudget; // Time for tracking a frame during playback; in milliseconds
+    FrameCache frameCache; // Rendered frames for scrubbing over already tracked frames
+    std::map<TrackedObject const *, unsigned long> cachedVersions; // Trajectory versions reflected by frameCache
+    MarkCompositor compositor; // Draws marks of all objects in a frame
+    unsigned long outputMarkedFrames; // Drawing of marks into the last output
+    double outputMarkTime; // In milliseconds per frame
+    unsigned int outputMarkTiles;
+    ImagePool imagePool; // Buffers of displayed frames
+    bool currentFrameDecoded; // False if the current frame was returned from the frame cache
+    unsigned long objectsRevision; // Changes when an object is deleted
+    unsigned int previewWidth; // Size of displayed frames; 0 - the video size
+    unsigned int previewHeight;
 
     std::vector<std::shared_ptr<TrackedObject>> trackedObjects;
+    mutable std::recursive_mutex objectsMutex; // Locked whenever trackedObjects are accessed
 };
 
 #endif // VIDEOTRACKER_H
@@ -36,6 +36,9 @@ AnchorItem::AnchorItem(ItemType type, int64_t timestamp, unsigned long timePosit
     case ItemType::CHANGE:
         nameString = tr("Trajectory change");
         break;
+    case ItemType::SCENE_CUT:
+        nameString = tr("Scene cut");
+        break;
     default:
         qDebug() << "ERROR - AnchorItem: Wrong ItemType";
         return;
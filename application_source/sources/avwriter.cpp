@@ -308,8 +308,6 @@ bool AVWriter::add_stream(AVStream **outputStream, const AVStream *inputStream)
 
 bool AVWriter::write_video_frame(VideoFrame &frame)
 {
-    assert(frame.get_mat_frame() != nullptr);
-
     int got_packet = 0;
 
     AVPacket pkt;
@@ -320,7 +318,7 @@ bool AVWriter::write_video_frame(VideoFrame &frame)
     pkt.size = 0;
     av_init_packet(&pkt);
 
-    AVFrame const *avFrame = frame.get_av_frame(); // frame converted from cv::Mat (part of VideoFrame)
+    AVFrame const *avFrame = frame.get_av_frame(); // frame in the output format (part of VideoFrame)
     if (!avFrame)
     {
        qDebug() << "Error: Cannot get frame converted to AVFrame";
@@ -13,11 +13,42 @@
 #define VIDEOTRACKING_TIME_BASE_Q AVRational{1, AV_TIME_BASE} // original AV_TIME_BASE_Q gives syntax error
 #define VIDEOTRACKING_MS_TIME_BASE_Q AVRational{1, 1000}
 
-FFmpegPlayer::FFmpegPlayer(std::string videoAddr, QProgressDialog const *progressDialog) :
-    scalingMethod(SWS_BILINEAR)
+FFmpegPlayer::FFmpegPlayer(std::string videoAddr, QProgressDialog const *progressDialog, bool exportMotionVectors) :
+    scalingMethod(SWS_BILINEAR),
+    exportMotionVectors(exportMotionVectors)
 {
     //av_register_all();
 
+    open_video(videoAddr);
+
+   //analyze_video(qApplication);
+   analyze_video(progressDialog);
+}
+
+FFmpegPlayer::FFmpegPlayer(std::string videoAddr, FFmpegPlayer const &analyzedPlayer) :
+    scalingMethod(SWS_BILINEAR),
+    exportMotionVectors(analyzedPlayer.exportMotionVectors)
+{
+    open_video(videoAddr);
+
+    // The same video was already analyzed, take over its results
+    firstPts = analyzedPlayer.firstPts;
+    firstPtsSet = analyzedPlayer.firstPtsSet;
+    firstTimestamp = analyzedPlayer.firstTimestamp;
+    firstTimestampSet = analyzedPlayer.firstTimestampSet;
+    framesIndexVector = analyzedPlayer.framesIndexVector;
+    framesTimestampSet = analyzedPlayer.framesTimestampSet;
+    keyframesTimestampSet = analyzedPlayer.keyframesTimestampSet;
+
+    if (!seek_first_packet())
+    {
+        qDebug() << "FFmpegPlayer: Cannot seek the first packet";
+        throw OpenException();
+    }
+}
+
+void FFmpegPlayer::open_video(std::string const &videoAddr)
+{
     videoStreamID = -1; // -1 -> no video stream
     audioStreamID = -1; // -1 -> no audio stream
     formatContext = nullptr;
@@ -97,6 +128,9 @@ FFmpegPlayer::FFmpegPlayer(std::string videoAddr, QProgressDialog const *progres
         throw OpenException();
     }
 
+    if (exportMotionVectors) // Motion vectors are used as a motion prior in tracking
+        videoContext->flags2 |= CODEC_FLAG2_EXPORT_MVS;
+
     // Open video codec
     if (avcodec_open2(videoContext, videoCodec, NULL) < 0)
     {
@@ -116,9 +150,6 @@ FFmpegPlayer::FFmpegPlayer(std::string videoAddr, QProgressDialog const *progres
     timeBase = formatContext->streams[videoStreamID]->time_base;
     qDebug() << "frame count: " << get_frame_count();
     qDebug() << "keyframe every: " << videoContext->gop_size << "x frame";
-
-   //analyze_video(qApplication);
-   analyze_video(progressDialog);
 }
 
 FFmpegPlayer::~FFmpegPlayer()
@@ -182,6 +213,9 @@ void FFmpegPlayer::analyze_video(QProgressDialog const *progressDialog)
                 //framesIdMap[frameID] = packet.pts;
                 //framesTimestampSet[packet.pts] = frameID++;
                 framesTimestampSet.insert(packet.pts);
+
+                if (packet.flags & AV_PKT_FLAG_KEY)
+                    keyframesTimestampSet.insert(packet.pts); // Used for reading the video backward
             }
         }
         // Free the packet that was allocated by av_read_frame
@@ -204,6 +238,17 @@ void FFmpegPlayer::analyze_video(QProgressDialog const *progressDialog)
 }
 
 
+void FFmpegPlayer::set_motion_vectors(bool enabled)
+{
+    exportMotionVectors = enabled;
+
+    // The decoder checks the flag for each decoded frame; the codec does not need to be opened again
+    if (enabled)
+        videoContext->flags2 |= CODEC_FLAG2_EXPORT_MVS;
+    else
+        videoContext->flags2 &= ~CODEC_FLAG2_EXPORT_MVS;
+}
+
 double FFmpegPlayer::get_fps() const
 {
 //    return formatContext->bit_rate;
@@ -211,6 +256,11 @@ double FFmpegPlayer::get_fps() const
     return formatContext->streams[videoStreamID]->nb_frames * VIDEOTRACKING_MS2DURATION / static_cast<double>(get_total_time());
 }
 
+std::set<int64_t> const &FFmpegPlayer::get_keyframe_timestamps() const
+{
+    return keyframesTimestampSet;
+}
+
 unsigned long FFmpegPlayer::get_frame_count() const
 {
     return framesTimestampSet.size();
@@ -294,6 +344,11 @@ bool FFmpegPlayer::get_current_frame(VideoFrame *frame)
 }
 
 bool FFmpegPlayer::get_frame_by_time(VideoFrame *resultFrame, unsigned long time)
+{
+    return get_frame_by_timestamp(resultFrame, get_timestamp_by_time(time));
+}
+
+int64_t FFmpegPlayer::get_timestamp_by_time(unsigned long time) const
 {
     int64_t approximateTimestamp = av_rescale_q(time, VIDEOTRACKING_MS_TIME_BASE_Q, timeBase);
 
@@ -303,9 +358,16 @@ bool FFmpegPlayer::get_frame_by_time(VideoFrame *resultFrame, unsigned long time
     if (iterator == framesTimestampSet.end()) // approximateTimestamp is higher than all timestmaps; use the highest timestamp
         iterator--;
 
-    int64_t exactTimestamp = *iterator;
+    return *iterator;
+}
+
+bool FFmpegPlayer::get_timestamp_by_number(unsigned long frameNumber, int64_t &timestamp) const
+{
+    if (frameNumber < 1 || frameNumber > framesIndexVector.size())
+        return false;
 
-    return get_frame_by_timestamp(resultFrame, exactTimestamp);
+    timestamp = framesIndexVector[frameNumber-1];
+    return true;
 }
 
 /** exactPosition - if frame with the exact timestamp does not exist, return false;
@@ -364,7 +426,9 @@ bool FFmpegPlayer::get_frame_by_timestamp(VideoFrame *resultFrame, int64_t times
 
 bool FFmpegPlayer::get_frame_by_number(VideoFrame *resultFrame, unsigned long frameNumber)
 {
-    int64_t timestamp = framesIndexVector[frameNumber-1];
+    int64_t timestamp;
+    if (!get_timestamp_by_number(frameNumber, timestamp))
+        return false;
 
     return get_frame_by_timestamp(resultFrame, timestamp);
 
@@ -401,6 +465,42 @@ bool FFmpegPlayer::get_previous_frame(VideoFrame *resultFrame)
     return true;
 }
 
+bool FFmpegPlayer::read_frames_backward(int64_t timestamp, std::vector<VideoFrame *> const &buffer, unsigned int &count)
+{
+    count = 0;
+
+    auto iterator = framesTimestampSet.find(timestamp);
+    if (iterator == framesTimestampSet.end())
+        return false;
+
+    if (iterator == framesTimestampSet.begin() || buffer.empty())
+        return true; // There is no previous frame
+
+    // Beginning of the GOP that contains the previous frame
+    auto keyframe = keyframesTimestampSet.lower_bound(timestamp);
+    int64_t gopTimestamp = (keyframe == keyframesTimestampSet.begin()) ? *(framesTimestampSet.begin()) : *(--keyframe);
+
+    // Read the whole GOP or only its last frames if it does not fit into the buffer
+    auto first = iterator;
+    unsigned int framesCount = 0;
+    do
+    {
+        first--;
+        framesCount++;
+    } while (first != framesTimestampSet.begin() && framesCount < buffer.size() && *first > gopTimestamp);
+
+    if (!get_frame_by_timestamp(buffer[0], *first))
+        return false;
+
+    for (count = 1; count < framesCount; count++)
+    {
+        if (!get_next_frame(buffer[count]))
+            return false;
+    }
+
+    return true;
+}
+
 // read_frame cannot be called two times at the same time (at least until AVPacket is used)
 // AVFrame *frame needs to be allocated before (no need for buffer)
 bool FFmpegPlayer::read_frame(AVPacket &packet, bool onlyVideoPackets, bool *isAudio)
@@ -0,0 +1,99 @@
+/**
+ * @file foregroundmask.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "foregroundmask.h"
+
+#include "opencvx/cvbackground.h"
+#include "opencvx/cvopening.h"
+#include "opencvx/cvclosing.h"
+
+#include <algorithm>
+
+ForegroundMask::ForegroundMask()
+{
+    frameNumber = 0;
+    referenceValid = false;
+    valid = false;
+}
+
+bool ForegroundMask::update(cv::Mat const &frame, cv::Size frameSize, unsigned long newFrameNumber)
+{
+    cv::Size smallSize = get_downsampled_size(frameSize);
+    if (frame.size() == smallSize)
+        frame.copyTo(small);
+    else
+        cv::resize(frame, small, smallSize, 0, 0, cv::INTER_AREA);
+
+    bool continuous = referenceValid && reference.size() == smallSize && reference.channels() == small.channels() &&
+            newFrameNumber > frameNumber && newFrameNumber - frameNumber <= VIDEOTRACKING_FOREGROUND_MAX_STEP;
+    frameNumber = newFrameNumber;
+
+    if (!continuous)
+    { // Seek or the first frame; nothing to compare with
+        small.convertTo(reference, CV_32FC3);
+        referenceValid = true;
+        valid = false;
+        return false;
+    }
+
+    mask.create(smallSize, CV_8UC1);
+    IplImage smallImage = small;
+    IplImage referenceImage = reference;
+    IplImage maskImage = mask;
+    // Squared differences of all channels are summed; the threshold is set for three channels
+    cvBackground(&smallImage, &referenceImage, &maskImage, VIDEOTRACKING_FOREGROUND_THRESHOLD * small.channels() / 3);
+    cvOpening(&maskImage, &maskImage); // Removes noise
+    cvClosing(&maskImage, &maskImage); // Fills holes inside moving objects
+
+    cv::integral(mask, integralMask, CV_32S);
+
+    cv::accumulateWeighted(small, reference, VIDEOTRACKING_FOREGROUND_LEARNING_RATE);
+
+    valid = true;
+    return true;
+}
+
+cv::Size ForegroundMask::get_downsampled_size(cv::Size frameSize)
+{
+    return cv::Size(std::max(1, frameSize.width / VIDEOTRACKING_FOREGROUND_SCALE),
+                    std::max(1, frameSize.height / VIDEOTRACKING_FOREGROUND_SCALE));
+}
+
+void ForegroundMask::reset()
+{
+    frameNumber = 0;
+    referenceValid = false;
+    valid = false;
+}
+
+bool ForegroundMask::is_valid() const
+{
+    return valid;
+}
+
+unsigned long ForegroundMask::get_frame_number() const
+{
+    return frameNumber;
+}
+
+double ForegroundMask::get_foreground_ratio(cv::Rect const &box) const
+{
+    if (!valid)
+        return 1;
+
+    int x1 = std::max(0, box.x / VIDEOTRACKING_FOREGROUND_SCALE);
+    int y1 = std::max(0, box.y / VIDEOTRACKING_FOREGROUND_SCALE);
+    int x2 = std::min(mask.cols, (box.x + box.width + VIDEOTRACKING_FOREGROUND_SCALE - 1) / VIDEOTRACKING_FOREGROUND_SCALE);
+    int y2 = std::min(mask.rows, (box.y + box.height + VIDEOTRACKING_FOREGROUND_SCALE - 1) / VIDEOTRACKING_FOREGROUND_SCALE);
+
+    if (x2 <= x1 || y2 <= y1)
+        return 0; // Box is outside of the frame
+
+    int sum = integralMask.at<int>(y2, x2) - integralMask.at<int>(y1, x2) -
+            integralMask.at<int>(y2, x1) + integralMask.at<int>(y1, x1);
+
+    return static_cast<double>(sum) / ((x2 - x1) * (y2 - y1));
+}
@@ -0,0 +1,87 @@
+/**
+ * @file framecache.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "framecache.h"
+
+FrameCache::FrameCache(size_t budget) :
+    budget(budget),
+    bytes(0)
+{
+}
+
+bool FrameCache::find(int64_t timestamp, unsigned long revision, bool includeOriginal, QImage &image, QImage &originalImage,
+                      unsigned long &timePosition, unsigned long &frameNumber)
+{
+    auto found = index.find(timestamp);
+    if (found == index.end())
+        return false;
+
+    auto entry = found->second;
+    if (entry->revision != revision)
+    { // Rendered with marks that have changed since
+        erase(entry);
+        return false;
+    }
+
+    if (includeOriginal && entry->originalImage.isNull())
+        return false;
+
+    entries.splice(entries.begin(), entries, entry);
+
+    image = entry->image; // Implicitly shared; no pixels are copied
+    if (includeOriginal)
+        originalImage = entry->originalImage;
+    timePosition = entry->timePosition;
+    frameNumber = entry->frameNumber;
+    return true;
+}
+
+void FrameCache::insert(int64_t timestamp, unsigned long revision, QImage const &image, QImage const &originalImage,
+                        unsigned long timePosition, unsigned long frameNumber)
+{
+    auto found = index.find(timestamp);
+    if (found != index.end())
+        erase(found->second);
+
+    size_t entryBytes = image.byteCount();
+    if (!originalImage.isNull() && originalImage.constBits() != image.constBits()) // Frames without marks share the buffer
+        entryBytes += originalImage.byteCount();
+    if (entryBytes > budget)
+        return;
+
+    entries.push_front(Entry{timestamp, revision, image, originalImage, timePosition, frameNumber, entryBytes});
+    index[timestamp] = entries.begin();
+    bytes += entryBytes;
+
+    while (bytes > budget)
+        erase(--entries.end());
+}
+
+void FrameCache::remove(int64_t timestamp)
+{
+    auto found = index.find(timestamp);
+    if (found != index.end())
+        erase(found->second);
+}
+
+void FrameCache::clear()
+{
+    entries.clear();
+    index.clear();
+    bytes = 0;
+}
+
+size_t FrameCache::get_budget() const
+{
+    return budget;
+}
+
+void FrameCache::erase(std::list<Entry>::iterator entry)
+{
+    bytes -= entry->bytes;
+    index.erase(entry->timestamp);
+    entries.erase(entry);
+}
@@ -27,43 +27,27 @@ ImageLabel::~ImageLabel()
 
 void ImageLabel::show_without_selection()
 {
-    setPixmap(QPixmap::fromImage(scaledImage));
+    update();
     show();
 }
 
 void ImageLabel::show_with_selection()
 {
-    QImage editImage = scaledImage;
-    QPainter painter(&editImage);
-
-
-    assert(scaledHeight > 0);
-    assert(scaledWidth > 0);
-
-    double widthRatio = scaledImage.width() / static_cast<double>(scaledWidth);
-    double heightRatio = scaledImage.height() / static_cast<double>(scaledHeight);
-
-
-    painter.setBrush(QColor(0,0,0,170));
-    painter.setPen(QColor(255,255,255,200));
-    painter.drawRect(selection.x * widthRatio, selection.y * heightRatio
-                     , selection.width * widthRatio, selection.height * heightRatio);
-    painter.end(); // Not needed - destructs itself
-
-    setPixmap(QPixmap::fromImage(editImage));
+    update();
     show();
-
-    return;
 }
 
-void ImageLabel::set_image(QImage const &image, int displayWidth, int displayHeight)
+void ImageLabel::set_image(QImage const &image, int displayWidth, int displayHeight, QSize const &sourceSize)
 {
-    imgWidth = image.width();
-    imgHeight = image.height();
+    // The image may be already scaled down; the selection is returned in the coordinates of the video
+    imgWidth = sourceSize.isValid() ? sourceSize.width() : image.width();
+    imgHeight = sourceSize.isValid() ? sourceSize.height() : image.height();
 
-    scaledImage = image.scaled(displayWidth, displayHeight, Qt::KeepAspectRatio);
+    // The image is not scaled here; it is scaled while painted
+    this->image = image;
+    displaySize = image.size().scaled(displayWidth, displayHeight, Qt::KeepAspectRatio);
 
-    resize(scaledImage.width(), scaledImage.height());
+    resize(displaySize);
     //this->setGeometry(0, 0, scaledImage.width(), scaledImage.height());
 
     //if (isSelected)
@@ -73,6 +57,35 @@ void ImageLabel::set_image(QImage const &image, int displayWidth, int displayHei
         show_without_selection();
 }
 
+void ImageLabel::clear_image()
+{
+    image = QImage();
+    update();
+}
+
+void ImageLabel::paintEvent(QPaintEvent *)
+{
+    if (image.isNull())
+        return;
+
+    QPainter painter(this);
+    painter.drawImage(QRect(QPoint(0, 0), displaySize), image);
+
+    if (!selectionEnabled)
+        return;
+
+    assert(scaledHeight > 0);
+    assert(scaledWidth > 0);
+
+    double widthRatio = displaySize.width() / static_cast<double>(scaledWidth);
+    double heightRatio = displaySize.height() / static_cast<double>(scaledHeight);
+
+    painter.setBrush(QColor(0,0,0,170));
+    painter.setPen(QColor(255,255,255,200));
+    painter.drawRect(selection.x * widthRatio, selection.y * heightRatio
+                     , selection.width * widthRatio, selection.height * heightRatio);
+}
+
 void ImageLabel::resizeEvent(QResizeEvent *event)
 {
     isPressed = false; // User cannot be making a selection at the time of image resizing
@@ -133,8 +146,8 @@ void ImageLabel::mouseMoveEvent(QMouseEvent *event)
     curX = curX > 0 ? curX : 0;
     curY = curY > 0 ? curY : 0;
 
-    scaledWidth = scaledImage.width();
-    scaledHeight = scaledImage.height();
+    scaledWidth = displaySize.width();
+    scaledHeight = displaySize.height();
 
     // count selection geometry:
     if (posX < curX)
@@ -194,8 +207,8 @@ void ImageLabel::set_selection_enabled(bool enabled)
     }
     else
     {
-        scaledWidth = scaledImage.width();
-        scaledHeight = scaledImage.height();
+        scaledWidth = displaySize.width();
+        scaledHeight = displaySize.height();
         selection.angle = 0;
         selection.width = scaledWidth/2;
         selection.height = scaledHeight/2;
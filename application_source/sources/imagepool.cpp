@@ -0,0 +1,76 @@
+/**
+ * @file imagepool.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "imagepool.h"
+
+ImagePool::ImagePool(unsigned int maxBuffers) :
+    maxBuffers(maxBuffers)
+{
+}
+
+QImage ImagePool::get(int width, int height, cv::Mat &mat)
+{
+    std::shared_ptr<Buffer> buffer;
+    for (auto const &pooled: buffers)
+    {
+        if (!pooled->used && pooled->data.cols == width && pooled->data.rows == height)
+        {
+            buffer = pooled;
+            break;
+        }
+    }
+
+    if (!buffer)
+    {
+        if (buffers.size() >= maxBuffers)
+        { // A free buffer of another size is replaced; if all are used, the new one is not kept
+            for (auto pooled = buffers.begin(); pooled != buffers.end(); ++pooled)
+            {
+                if (!(*pooled)->used)
+                {
+                    buffers.erase(pooled);
+                    break;
+                }
+            }
+        }
+
+        buffer = std::make_shared<Buffer>();
+        buffer->data.create(height, width, CV_8UC4);
+        if (buffers.size() < maxBuffers)
+            buffers.push_back(buffer);
+    }
+
+    buffer->used = true;
+    mat = buffer->data;
+
+    // QImage does not copy the data as it is not const
+    return QImage(buffer->data.data, width, height, buffer->data.step, QImage::Format_RGB32,
+                  release, new std::shared_ptr<Buffer>(buffer));
+}
+
+void ImagePool::set_max_buffers(unsigned int maxBuffers)
+{
+    this->maxBuffers = maxBuffers;
+}
+
+void ImagePool::clear()
+{
+    std::vector<std::shared_ptr<Buffer>> usedBuffers;
+    for (auto const &buffer: buffers)
+    {
+        if (buffer->used)
+            usedBuffers.push_back(buffer);
+    }
+
+    buffers.swap(usedBuffers);
+}
+
+void ImagePool::release(void *info)
+{
+    std::shared_ptr<Buffer> *buffer = static_cast<std::shared_ptr<Buffer> *>(info);
+    (*buffer)->used = false;
+    delete buffer; // The buffer is freed here if the pool no longer holds it
+}
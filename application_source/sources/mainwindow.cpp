@@ -10,6 +10,8 @@
 #include "selection.h"
 #include "colors.h"
 #include "objectshape.h"
+#include "trackingpreset.h"
+#include "projectformat.h"
 
 #include <cereal/archives/json.hpp>
 #include <cereal/archives/xml.hpp>
@@ -34,6 +36,8 @@
 #define VIDEOTRACKING_TIMER_CONSTANT 1.5
 #define VIDEOTRACKING_TIMER_CONSTANT_FAST 0.5
 #define VIDEOTRACKING_TIMER_CONSTANT_SLOW 0.2
+#define VIDEOTRACKING_TRACKING_BUDGET_RATIO 0.5 // Part of the frame interval that can be spent by tracking during playback
+#define VIDEOTRACKING_REDUCED_TRACKING_HEIGHT 540 // Height of tracking frames when tracking at a reduced resolution
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -87,6 +91,9 @@ MainWindow::MainWindow(QWidget *parent) :
         ui->actionCzech->setChecked(true);
 
     tracker = nullptr; // Will be initialized when new video is loaded
+    trajectoryTabObject = 0;
+    trajectoryTabVersion = 0;
+    anchorsSceneCut = false;
     timer = new QTimer(this); //Is set when play button clicked
 
     // Should original video be showed?
@@ -102,6 +109,42 @@ MainWindow::MainWindow(QWidget *parent) :
     }
     ui->originalVideoFrame->setVisible(showOriginalVideo);
 
+    // Should objects be tracked at a reduced resolution?
+    if (settings->contains("reducedTracking"))
+        reducedTracking = settings->value("reducedTracking").toBool();
+    else
+    {   // Not set => set default value
+        reducedTracking = false;
+        settings->setValue("reducedTracking", reducedTracking);
+    }
+
+    // Should particles be pruned by a foreground mask?
+    if (settings->contains("foregroundGating"))
+        foregroundGating = settings->value("foregroundGating").toBool();
+    else
+    {   // Not set => set default value
+        foregroundGating = false;
+        settings->setValue("foregroundGating", foregroundGating);
+    }
+
+    // Should objects be tracked in luma only?
+    if (settings->contains("lumaTracking"))
+        lumaTracking = settings->value("lumaTracking").toBool();
+    else
+    {   // Not set => set default value
+        lumaTracking = false;
+        settings->setValue("lumaTracking", lumaTracking);
+    }
+
+    // Should particles be shifted by motion vectors?
+    if (settings->contains("motionPrior"))
+        motionPrior = settings->value("motionPrior").toBool();
+    else
+    {   // Not set => set default value
+        motionPrior = false;
+        settings->setValue("motionPrior", motionPrior);
+    }
+
     // Display time / frame numbers
     if (settings->contains("showTime"))
     { // Is displayTime variable set in settings?
@@ -178,10 +221,16 @@ void MainWindow::reload_video_label()
 
     if (tracker)
     {
-        ui->videoLabel->set_image(frame, ui->videoFrame->width(), ui->videoFrame->height());
+        // Following frames are converted at the size of the viewport; the shown frame is only painted scaled.
+        // It is not read again here as resizing may be handled while a frame is being tracked.
+        tracker->set_preview_size(ui->videoFrame->width(), ui->videoFrame->height());
+
+        ui->videoLabel->set_image(frame, ui->videoFrame->width(), ui->videoFrame->height(),
+                                  QSize(tracker->get_width(), tracker->get_height()));
 
         if (showOriginalVideo)
-            ui->originalVideoLabel->set_image(originalFrame, ui->originalVideoFrame->width(), ui->originalVideoFrame->height());
+            ui->originalVideoLabel->set_image(originalFrame, ui->originalVideoFrame->width(), ui->originalVideoFrame->height(),
+                                              QSize(tracker->get_width(), tracker->get_height()));
     }
 
 }
@@ -192,6 +241,9 @@ void MainWindow::pause()
     ui->playButton->setText(tr("Play"));
     timer->stop();
 
+    if (tracker)
+        tracker->set_tracking_budget(0); // Paused frames are tracked at full quality
+
 }
 
 /* Play / Pause */
@@ -218,6 +270,7 @@ void MainWindow::play()
         }
 
         timer->start(); // Displays new frames in given interval.
+        tracker->set_tracking_budget(timer->interval() * VIDEOTRACKING_TRACKING_BUDGET_RATIO);
       }
 }
 
@@ -227,6 +280,7 @@ void MainWindow::stop()
     isPlaying = false;
 
     timer->stop();
+    tracker->set_tracking_budget(0);
 
     ui->playButton->setText(tr("Play"));
     ui->stepBackButton->setEnabled(true);
@@ -361,6 +415,13 @@ void MainWindow::open_video_successful()
     ui->originalVideoTextLabel->setVisible(true);
 
     set_application_menu();
+
+    tracker->set_tracking_resolution(reducedTracking ? VIDEOTRACKING_REDUCED_TRACKING_HEIGHT : 0);
+    tracker->set_foreground_gating(foregroundGating);
+    tracker->set_luma_tracking(lumaTracking);
+    tracker->set_motion_prior(motionPrior);
+    tracker->set_preview_size(ui->videoFrame->width(), ui->videoFrame->height());
+    tracker->start_background_tracking(); // Tracks objects ahead of the playhead
     show_next_frame(); // Displays first frame
 }
 
@@ -409,13 +470,24 @@ void MainWindow::show_frame()
 
     //qDebug() << "frame number" << tracker->get_frame_number();
 
-    ui->videoLabel->set_image(frame, ui->videoFrame->width(), ui->videoFrame->height());
+    ui->videoLabel->set_image(frame, ui->videoFrame->width(), ui->videoFrame->height(),
+                              QSize(tracker->get_width(), tracker->get_height()));
 
     if (showOriginalVideo)
-        ui->originalVideoLabel->set_image(originalFrame, ui->originalVideoFrame->width(), ui->originalVideoFrame->height());
+        ui->originalVideoLabel->set_image(originalFrame, ui->originalVideoFrame->width(), ui->originalVideoFrame->height(),
+                                          QSize(tracker->get_width(), tracker->get_height()));
 
     if (tracker->get_objects_count())
-        set_trajectory_tab(ui->objectsBox->currentData().toUInt(), false, false);
+    {
+        unsigned int id = ui->objectsBox->currentData().toUInt();
+        set_trajectory_tab(id, false, false);
+
+        int64_t cutTimestamp;
+        unsigned long cutTimePosition;
+        unsigned long cutFrameNumber;
+        if (tracker->get_object_scene_cut(id, cutTimestamp, cutTimePosition, cutFrameNumber) != anchorsSceneCut)
+            set_anchors_tab(id); // A scene cut was detected or removed while tracking
+    }
 
     //qDebug()<< "slider position: " << ui->positionSlider->value();
 }
@@ -604,6 +676,8 @@ void MainWindow::speed_general()
         speed += timerSpeed*VIDEOTRACKING_TIMER_CONSTANT_SLOW;
 
     timer->setInterval(timerInterval / speed);
+    if (isPlaying)
+        tracker->set_tracking_budget(timer->interval() * VIDEOTRACKING_TRACKING_BUDGET_RATIO);
     ui->speedLabel->setText(tr("Speed:") + " " + QString::number(speed, 'f', 2) + "x");
 }
 
@@ -659,7 +733,14 @@ void MainWindow::create_output()
     try
     {
         tracker->create_output(filename.toStdString(), fileProgressDialog, &trackingProgressDialog, inFileExtension);
-        alert->setText(tr("Output successfully created"));
+
+        // Time of drawing the marks is reported separately from encoding
+        unsigned long markedFrames;
+        double markTime;
+        unsigned int markTiles;
+        tracker->get_output_statistics(markedFrames, markTime, markTiles);
+        alert->setText(tr("Output successfully created\nMarks drawn into %1 frames: %2 ms per frame in %3 tiles")
+                       .arg(markedFrames).arg(markTime, 0, 'f', 2).arg(markTiles));
     } catch (OutputException) {
         qDebug() << "ERROR: Output creating not successful";
         alert->setText(tr("Error occured when creating the output file. Output was not created."));
@@ -706,6 +787,11 @@ void MainWindow::set_form_values()
     shapesMap.clear();
     shapesMap[ObjectShape::RECTANGLE] = tr("Rectangle");
     shapesMap[ObjectShape::ELLIPSE] = tr("Ellipse");
+
+    trackingPresetsMap.clear();
+    trackingPresetsMap[TrackingPreset::FAST] = tr("Fast");
+    trackingPresetsMap[TrackingPreset::BALANCED] = tr("Balanced");
+    trackingPresetsMap[TrackingPreset::ACCURATE] = tr("Accurate");
 }
 
 void MainWindow::show_anchors_menu(QListWidgetItem *item)
@@ -715,8 +801,10 @@ void MainWindow::show_anchors_menu(QListWidgetItem *item)
 
     QAction *showFrame = nullptr;
     QAction *changePosition = nullptr;
+    QAction *trackBackward = nullptr;
     QAction *setEndFrame = nullptr;
     QAction *setVideoEnd = nullptr;
+    QAction *ignoreSceneCut = nullptr;
     QAction *deleteItem = nullptr;
 
     QMenu *menu = new QMenu(tr("Edit item"), this);
@@ -731,6 +819,9 @@ void MainWindow::show_anchors_menu(QListWidgetItem *item)
         changePosition = menu->addAction(tr("Change position"));
         changePosition->setToolTip(tr("Change the initial position of this object"));
 
+        trackBackward = menu->addAction(tr("Track backward"));
+        trackBackward->setToolTip(tr("Track the object in the frames preceding this item"));
+
         if (type == ItemType::CHANGE)
         {
             deleteItem = menu->addAction(tr("Delete item"));
@@ -753,6 +844,11 @@ void MainWindow::show_anchors_menu(QListWidgetItem *item)
             setEndFrame->setToolTip(tr("Set a frame where tracking for this object shall stop"));
         }
     }
+    else if (type == ItemType::SCENE_CUT)
+    {
+        ignoreSceneCut = menu->addAction(tr("Ignore scene cut"));
+        ignoreSceneCut->setToolTip(tr("Track this object further; it is still present after this frame"));
+    }
 
     editingAnchorItem->set_highlight(true); // Keeps the item highlighted even with context menu over it
     //menu->exec(editingAnchorItem->mapToGlobal(QPoint(0,0))); // Show at widget position
@@ -781,6 +877,10 @@ void MainWindow::show_anchors_menu(QListWidgetItem *item)
 
         set_selection(SelectionState::CHANGE_POSITION);
     }
+    else if (selectedOption == trackBackward)
+    {
+        track_backward();
+    }
     else if (selectedOption == setEndFrame)
     {
         set_end_frame();
@@ -789,6 +889,15 @@ void MainWindow::show_anchors_menu(QListWidgetItem *item)
     {
         set_video_end();
     }
+    else if (selectedOption == ignoreSceneCut)
+    {
+        unsigned int objectID = ui->objectsBox->currentData().toUInt();
+
+        tracker->ignore_object_scene_cut(objectID);
+        set_anchors_tab(objectID);
+
+        projectChanged = true;
+    }
 
     else if (selectedOption == deleteItem)
     {
@@ -927,6 +1036,7 @@ void MainWindow::set_object_settings()
     unsigned int id = ui->objectsBox->currentData().toUInt();
     set_appearance_tab(id);
     set_anchors_tab(id);
+    set_general_tab(id);
 }
 
 void MainWindow::set_appearance_tab(unsigned int id)
@@ -941,6 +1051,7 @@ void MainWindow::set_appearance_tab(unsigned int id)
     ui->defocusButton->setChecked(originalObjectAppearance.defocus);
     ui->colorButton->setChecked(!originalObjectAppearance.defocus);
     ui->defocusSizeBox->setValue(originalObjectAppearance.defocusSize);
+    ui->blurBox->setChecked(originalObjectAppearance.blur);
     ui->drawInsideBox->setChecked(originalObjectAppearance.drawInside);
     ui->drawBorderBox->setChecked(originalObjectAppearance.drawBorder);
     ui->colorBox->setCurrentIndex(ui->colorBox->findData(originalObjectAppearance.colorID));
@@ -953,66 +1064,105 @@ void MainWindow::set_appearance_tab(unsigned int id)
     settingObjectSettings = false;
 }
 
+void MainWindow::set_general_tab(unsigned int id)
+{
+    settingObjectSettings = true; // Disables change_tracking_stride(), change_tracking_preset() and change_tracking_options()
+    ui->trackingStrideBox->setValue(tracker->get_object_tracking_stride(id));
+
+    TrackingParameters parameters = tracker->get_object_tracking_parameters(id);
+    ui->trackingPresetBox->setCurrentIndex(ui->trackingPresetBox->findData(parameters.preset));
+    ui->faceModeBox->setChecked(parameters.faceMode);
+    ui->pcaModelBox->setChecked(parameters.pcaModel);
+    ui->trackingCostLabel->setText(tr("Predicted cost per frame: %1x of Balanced").arg(parameters.get_relative_cost(), 0, 'f', 1));
+    settingObjectSettings = false;
+}
+
 /* if clear==true, trajectory is set from scratch */
 void MainWindow::set_trajectory_tab(unsigned int id, bool clear, bool showProgressBar)
 {
-    if (clear)
+    if (clear || id != trajectoryTabObject)
+    {
         ui->trajectoryWidget->clear(); // Clears to add all items again to empty list
+        trajectoryTabObject = id;
+        trajectoryTabVersion = 0;
+    }
 
     QListWidgetItem *listItem = nullptr;
     TrajectoryItem *item = nullptr;
 
-    auto trajectory = tracker->get_object_trajectory(id);
-
-    auto iterator = trajectory.begin();
-    if (ui->trajectoryWidget->count() > 0)
-    { // the list is not empty, find the last one and start adding from the following one
-
-        // Find last item and its timestamp:
-        QListWidgetItem *lastItem = ui->trajectoryWidget->item(ui->trajectoryWidget->count()-1); // The Last item
-        TrajectoryItem *lastTrajectoryItem = static_cast<TrajectoryItem *>(ui->trajectoryWidget->itemWidget(lastItem));
-        int64_t lastTimestamp = lastTrajectoryItem->get_timestamp();
-
-        iterator = trajectory.find(lastTimestamp);
-
-        if (iterator == trajectory.end())
-        { // This should never occur; It is here just for a safety reason.
-            iterator = trajectory.begin();
-            ui->trajectoryWidget->clear();
-        }
-        else
-        {
-            iterator++; // Start adding from the next one
-        }
-    }
+    // Only entries added or changed since the list was filled the last time are read
+    std::vector<std::pair<int64_t, TrajectoryEntry>> entries;
+    bool followed = tracker->get_object_trajectory_changes(id, trajectoryTabVersion, entries);
+    if (!followed)
+        ui->trajectoryWidget->clear(); // Entries were erased; all entries are returned
 
     QProgressDialog progressDialog(tr("Setting Trajectory tab"), tr("Cancel"), 0, 0, this);
-    if (showProgressBar && iterator != trajectory.end())
+    if (showProgressBar && !entries.empty())
     { // This operation might take a while -> show a progress dialog
         progressDialog.setWindowTitle(tr("Trajectory tab"));
         progressDialog.setModal(true);
         progressDialog.show();
     }
-    while (iterator != trajectory.end())
+
+    for (auto const &changed: entries)
     {
-        TrajectoryEntry entry = iterator->second;
+        // Items are sorted by timestamp; the row is found by a binary search
+        int row = 0;
+        int last = ui->trajectoryWidget->count();
+        while (row < last)
+        {
+            int middle = (row + last) / 2;
+            QListWidgetItem *middleItem = ui->trajectoryWidget->item(middle);
+            if (static_cast<TrajectoryItem *>(ui->trajectoryWidget->itemWidget(middleItem))->get_timestamp() < changed.first)
+                row = middle + 1;
+            else
+                last = middle;
+        }
+
+        if (row < ui->trajectoryWidget->count())
+        {
+            QListWidgetItem *rowItem = ui->trajectoryWidget->item(row);
+            if (static_cast<TrajectoryItem *>(ui->trajectoryWidget->itemWidget(rowItem))->get_timestamp() == changed.first)
+                delete ui->trajectoryWidget->takeItem(row); // Changed entry; e.g. refined interpolated position
+        }
+
+        TrajectoryEntry const &entry = changed.second;
         listItem = new QListWidgetItem();
-        item = new TrajectoryItem(iterator->first, entry.timePosition, tracker->get_total_time(),
+        item = new TrajectoryItem(changed.first, entry.timePosition, tracker->get_total_time(),
                                   entry.frameNumber, tracker->get_frame_count(), entry.position,
-                                  this, displayTime);
-        ui->trajectoryWidget->addItem(listItem);
+                                  this, displayTime, entry.interpolated, entry.is_low_confidence());
+        if (entry.particles)
+            item->setToolTip(tr("Matching error: %1, particles: %2, skipped by foreground: %3, evaluation time: %4 ms")
+                             .arg(entry.matchError, 0, 'f', 1).arg(entry.particles).arg(entry.prunedParticles)
+                             .arg(entry.evaluationTime, 0, 'f', 2));
+        ui->trajectoryWidget->insertItem(row, listItem);
         ui->trajectoryWidget->setItemWidget(listItem, item); // Takes ownership of listItem => frees automatically
         listItem->setSizeHint(QSize(listItem->sizeHint().width(), 50));
 
-        if (progressDialog.wasCanceled()) // User cancelled the progress dialog
+        if (progressDialog.wasCanceled())
+        { // User cancelled the progress dialog; the list is filled again the next time
+            ui->trajectoryWidget->clear();
+            trajectoryTabVersion = 0;
             return;
+        }
 
         qApp->processEvents(); // Keeps progress bar active
-
-        iterator++;
     }
     progressDialog.cancel();
 
+    if (followed && entries.empty())
+        return; // Nothing has changed, neither has the telemetry
+
+    double averageError, averageParticles, averagePruned, averageTime;
+    unsigned int lowConfidence;
+    if (tracker->get_object_telemetry(id, averageError, averageParticles, averagePruned, averageTime, lowConfidence))
+        ui->trajectoryWidget->setToolTip(tr("Average matching error: %1, particles: %2, skipped by foreground: %3, "
+                                            "evaluation time: %4 ms; %5 frames of low confidence")
+                                         .arg(averageError, 0, 'f', 1).arg(averageParticles, 0, 'f', 0)
+                                         .arg(averagePruned, 0, 'f', 0).arg(averageTime, 0, 'f', 2).arg(lowConfidence));
+    else
+        ui->trajectoryWidget->setToolTip(QString());
+
 }
 
 void MainWindow::trajectory_show_frame(QListWidgetItem *item)
@@ -1044,6 +1194,20 @@ void MainWindow::set_anchors_tab(unsigned int id)
         type = ItemType::CHANGE;
     }
 
+    int64_t cutTimestamp;
+    unsigned long cutTimePosition;
+    unsigned long cutFrameNumber;
+
+    anchorsSceneCut = tracker->get_object_scene_cut(id, cutTimestamp, cutTimePosition, cutFrameNumber);
+    if (anchorsSceneCut)
+    { // Tracking ended before the end; shown until the user ignores it
+        listItem = new QListWidgetItem();
+        item = new AnchorItem(ItemType::SCENE_CUT, cutTimestamp, cutTimePosition, tracker->get_total_time(),
+                              cutFrameNumber, tracker->get_frame_count(), this, true, displayTime);
+        ui->anchorsWidget->addItem(listItem);
+        ui->anchorsWidget->setItemWidget(listItem, item);
+    }
+
     int64_t endTimestamp;
     unsigned long endTimePosition;
     unsigned long endFrameNumber;
@@ -1100,6 +1264,16 @@ void MainWindow::change_defocus_size()
     change_appearance();
 }
 
+void MainWindow::change_blur()
+{
+    if (settingObjectSettings)
+        return;
+
+    alteredObjectAppearance.blur = ui->blurBox->isChecked();
+
+    change_appearance();
+}
+
 void MainWindow::change_color()
 {
     if (settingObjectSettings)
@@ -1277,6 +1451,12 @@ void MainWindow::show_appearance_tab()
        ui->shapeBox->addItem(shape.second, shape.first);
     }
 
+    ui->trackingPresetBox->clear();
+    for (auto const &preset: trackingPresetsMap)
+    {
+       ui->trackingPresetBox->addItem(preset.second, preset.first);
+    }
+
     ui->defocusSizeBox->setRange(2, 10000); // Value 1 would not have any effect; Maximum is much higher than could be needed.
     ui->borderThicknessBox->setRange(0, 255); // OpenCV accepts border thickness in range 0-255
 
@@ -1475,6 +1655,42 @@ void MainWindow::compute_trajectory()
     show_frame_by_timestamp(currentTimestamp); // restore player position before the computing started
 }
 
+void MainWindow::track_backward()
+{
+    assert(tracker);
+    pause();
+
+    // Save timestamp to restore it after the operation is complete
+    int64_t currentTimestamp = tracker->get_frame_timestamp();
+    unsigned currentObject = ui->objectsBox->currentData().toUInt();
+
+    QProgressDialog progressDialog(computingInfoText, tr("Cancel"), 0, 0, this);
+    progressDialog.setWindowTitle(computingInfoTitle);
+    progressDialog.setModal(true);
+    progressDialog.show();
+    try
+    {
+        if (!tracker->track_object_backward(currentObject, editingAnchorItem->get_timestamp(), &progressDialog))
+        {
+            qDebug() << "WARNING: Cannot track the object backward";
+            QMessageBox *alert = new QMessageBox(this);
+            alert->setWindowTitle(tr("Tracking backward"));
+            alert->setText(tr("Trajectory was not computed"));
+            alert->exec();
+        }
+    } catch (UserCanceledException)
+    {
+        qDebug() << "Tracking backward was canceled";
+    }
+
+    progressDialog.cancel();
+    projectChanged = true;
+
+    set_trajectory_tab(currentObject, true, true);
+
+    show_frame_by_timestamp(currentTimestamp); // restore player position before the computing started
+}
+
 void MainWindow::change_name()
 {
     if (enter_object_name(true))
@@ -1487,6 +1703,45 @@ void MainWindow::change_name()
     }
 }
 
+void MainWindow::change_tracking_stride()
+{
+    if (settingObjectSettings || !tracker || tracker->get_objects_count() == 0)
+        return;
+
+    tracker->set_object_tracking_stride(ui->objectsBox->currentData().toUInt(), ui->trackingStrideBox->value());
+    projectChanged = true;
+}
+
+void MainWindow::change_tracking_preset()
+{
+    if (settingObjectSettings || !tracker || tracker->get_objects_count() == 0)
+        return;
+
+    unsigned int id = ui->objectsBox->currentData().toUInt();
+    TrackingParameters parameters = TrackingParameters::from_preset(ui->trackingPresetBox->currentData().toUInt());
+    parameters.faceMode = ui->faceModeBox->isChecked();
+    parameters.pcaModel = ui->pcaModelBox->isChecked();
+    tracker->set_object_tracking_parameters(id, parameters);
+    set_general_tab(id);
+    set_trajectory_tab(id, true, false); // The trajectory is computed again
+    projectChanged = true;
+}
+
+void MainWindow::change_tracking_options()
+{
+    if (settingObjectSettings || !tracker || tracker->get_objects_count() == 0)
+        return;
+
+    unsigned int id = ui->objectsBox->currentData().toUInt();
+    TrackingParameters parameters = tracker->get_object_tracking_parameters(id);
+    parameters.faceMode = ui->faceModeBox->isChecked();
+    parameters.pcaModel = ui->pcaModelBox->isChecked();
+    tracker->set_object_tracking_parameters(id, parameters);
+    set_general_tab(id);
+    set_trajectory_tab(id, true, false); // The trajectory is computed again
+    projectChanged = true;
+}
+
 void MainWindow::selection_confirmed()
 {
     if (selectionState == SelectionState::NEW_OBJECT)
@@ -1578,18 +1833,23 @@ bool MainWindow::set_end_frame_confirm()
     return true;
 }
 
-void MainWindow::new_object_confirm(Selection const &selectedPosition)
+Characteristics MainWindow::get_default_appearance()
 {
-    assert(selectionState == SelectionState::NEW_OBJECT);
-
     unsigned defaultColor = Colors::BLACK;
     unsigned defaultBorderColor = Colors::RED;
 
     ObjectColor const &color = colorsMap[defaultColor].second;
     ObjectColor const &borderColor = colorsMap[defaultBorderColor].second;
 
-    Characteristics defaultAppearance(ObjectShape::RECTANGLE, true, 20, true, color,
-                                      Colors::BLACK, true, borderColor, Colors::RED, 3);
+    return Characteristics(ObjectShape::RECTANGLE, true, 20, true, color,
+                           Colors::BLACK, true, borderColor, Colors::RED, 3);
+}
+
+void MainWindow::new_object_confirm(Selection const &selectedPosition)
+{
+    assert(selectionState == SelectionState::NEW_OBJECT);
+
+    Characteristics defaultAppearance = get_default_appearance();
 
 
     int id;
@@ -1613,6 +1873,73 @@ void MainWindow::new_object_confirm(Selection const &selectedPosition)
     }
 }
 
+void MainWindow::detect_objects()
+{
+    assert(tracker);
+    pause();
+
+    QString cascadeFile = QFileDialog::getOpenFileName(this, tr("Select detector"), settings->value("detectorCascade").toString(),
+                                                       tr("Cascade classifier (*.xml)"));
+    if (cascadeFile.isEmpty())
+        return;
+
+    settings->setValue("detectorCascade", cascadeFile);
+
+    ObjectDetector detector;
+    if (!detector.load(cascadeFile.toStdString()))
+    {
+        QMessageBox *alert = new QMessageBox(this);
+        alert->setWindowTitle(tr("Detect objects"));
+        alert->setText(tr("The detector could not be loaded"));
+        alert->exec();
+        return;
+    }
+
+    bool ok;
+    int interval = QInputDialog::getInt(this, tr("Detect objects"), tr("Detect every n-th frame (0 - keyframes only):"),
+                                        0, 0, 1000, 1, &ok);
+    if (!ok)
+        return;
+
+    // Save timestamp to restore it after the operation is complete
+    int64_t currentTimestamp = tracker->get_frame_timestamp();
+    unsigned int objectsCount = tracker->get_objects_count();
+
+    QProgressDialog progressDialog(tr("Detecting objects..."), tr("Cancel"), 0, 0, this);
+    progressDialog.setWindowTitle(tr("Detect objects"));
+    progressDialog.setModal(true);
+    progressDialog.show();
+    try
+    {
+        tracker->detect_objects(detector, interval, get_default_appearance(), tr("Detected").toStdString(), &progressDialog);
+    } catch (UserCanceledException)
+    {
+        qDebug() << "Detection was canceled";
+    }
+
+    progressDialog.cancel();
+
+    unsigned int created = tracker->get_objects_count() - objectsCount;
+    if (created)
+    {
+        projectChanged = true;
+        show_objects_box(true);
+        set_object_settings();
+    }
+
+    // Time of the detector is reported separately from tracking
+    double detectionTime = detector.get_detection_time();
+    unsigned long detectedFrames = detector.get_detected_frames();
+    QMessageBox *alert = new QMessageBox(this);
+    alert->setWindowTitle(tr("Detect objects"));
+    alert->setText(tr("Objects created: %1\nDetector time: %2 s in %3 frames (%4 ms per frame)")
+                   .arg(created).arg(detectionTime / 1000, 0, 'f', 1).arg(detectedFrames)
+                   .arg(detectedFrames ? detectionTime / detectedFrames : 0, 0, 'f', 1));
+    alert->exec();
+
+    show_frame_by_timestamp(currentTimestamp); // restore player position before the computing started
+}
+
 void MainWindow::show_objects_box(bool noTabsUpdate)
 {
     // First disconnect this signal so alterig ui->objectsBox does not fire it every time
@@ -1793,6 +2120,66 @@ void MainWindow::show_original_video()
 
 }
 
+void MainWindow::reduce_tracking_resolution()
+{
+    reducedTracking = !reducedTracking;
+
+    settings->setValue("reducedTracking", reducedTracking);
+
+    ui->actionReducedTracking->setChecked(reducedTracking);
+
+    if (tracker)
+    {
+        pause();
+        tracker->set_tracking_resolution(reducedTracking ? VIDEOTRACKING_REDUCED_TRACKING_HEIGHT : 0);
+
+        if (tracker->get_objects_count())
+            set_trajectory_tab(ui->objectsBox->currentData().toUInt(), true, false); // Trajectory is tracked again
+    }
+}
+
+void MainWindow::gate_by_foreground()
+{
+    foregroundGating = !foregroundGating;
+
+    settings->setValue("foregroundGating", foregroundGating);
+
+    ui->actionForegroundGating->setChecked(foregroundGating);
+
+    if (tracker)
+        tracker->set_foreground_gating(foregroundGating);
+}
+
+void MainWindow::track_luma_only()
+{
+    lumaTracking = !lumaTracking;
+
+    settings->setValue("lumaTracking", lumaTracking);
+
+    ui->actionLumaTracking->setChecked(lumaTracking);
+
+    if (tracker)
+    {
+        pause();
+        tracker->set_luma_tracking(lumaTracking);
+
+        if (tracker->get_objects_count())
+            set_trajectory_tab(ui->objectsBox->currentData().toUInt(), true, false); // Trajectory is tracked again
+    }
+}
+
+void MainWindow::use_motion_prior()
+{
+    motionPrior = !motionPrior;
+
+    settings->setValue("motionPrior", motionPrior);
+
+    ui->actionMotionPrior->setChecked(motionPrior);
+
+    if (tracker)
+        tracker->set_motion_prior(motionPrior);
+}
+
 void MainWindow::set_czech_language()
 {
     ui->actionPlay->setEnabled(false);
@@ -1892,6 +2279,7 @@ bool MainWindow::save_project()
 
     settings->setValue("projectFormat", selectedFilter);
 
+    std::uint32_t projectFormat = VIDEOTRACKING_PROJECT_FORMAT; // Read before the other fields when loading
     { // Serialize with CEREAL
 
         if (selectedFilter == xmlFilter)
@@ -1903,7 +2291,7 @@ bool MainWindow::save_project()
 
             cereal::XMLOutputArchive oarchive(os);
 
-            oarchive(CEREAL_NVP(inputFileName), CEREAL_NVP(tracker), CEREAL_NVP(customColorsCount), cereal::make_nvp("colors", colorsMap));
+            oarchive(CEREAL_NVP(projectFormat), CEREAL_NVP(inputFileName), CEREAL_NVP(tracker), CEREAL_NVP(customColorsCount), cereal::make_nvp("colors", colorsMap));
             //oarchive(inputFileName, tracker, colorsMap);
         }
         else
@@ -1916,7 +2304,7 @@ bool MainWindow::save_project()
             cereal::JSONOutputArchive oarchive(os);
 
             //oarchive(inputFileName, tracker, colorsMap);
-            oarchive(CEREAL_NVP(inputFileName), CEREAL_NVP(tracker), CEREAL_NVP(customColorsCount), cereal::make_nvp("colors", colorsMap));
+            oarchive(CEREAL_NVP(projectFormat), CEREAL_NVP(inputFileName), CEREAL_NVP(tracker), CEREAL_NVP(customColorsCount), cereal::make_nvp("colors", colorsMap));
         }
 
     }
@@ -1991,12 +2379,18 @@ void MainWindow::load_project()
         if (selectedFilter == xmlFilter)
         { // XML
             cereal::XMLInputArchive iarchive(os);
+            ProjectFormat projectFormat(ProjectFormat::load(iarchive)); // Objects read only fields of this format
+            if (ProjectFormat::get() > VIDEOTRACKING_PROJECT_FORMAT)
+                throw cereal::Exception("Project saved in a newer format");
             iarchive(CEREAL_NVP(inputFileName), CEREAL_NVP(tracker), CEREAL_NVP(customColorsCount), cereal::make_nvp("colors", colorsMap));
             //iarchive(inputFileName, tracker, colorsMap);
         }
         else
         { // JSON
             cereal::JSONInputArchive iarchive(os);
+            ProjectFormat projectFormat(ProjectFormat::load(iarchive)); // Objects read only fields of this format
+            if (ProjectFormat::get() > VIDEOTRACKING_PROJECT_FORMAT)
+                throw cereal::Exception("Project saved in a newer format");
             iarchive(CEREAL_NVP(inputFileName), CEREAL_NVP(tracker), CEREAL_NVP(customColorsCount), cereal::make_nvp("colors", colorsMap));
             //iarchive(inputFileName, tracker, colorsMap);
         }
@@ -2123,6 +2517,8 @@ void MainWindow::initial_application_settings()
     projectChanged = false;
     settingObjectSettings = false; // Disables slots for appearance change (change_color(), ...) when setting new object
     isEndTimestampSet = false;
+    anchorsSceneCut = false;
+    trajectoryTabVersion = 0;
 
     projectFileName = "";
     projectName = "";
@@ -2161,10 +2557,12 @@ void MainWindow::initial_application_settings()
         display_frame_numbers();
 
     // Make the videoLabel empty
+    frame = QImage();
+    originalFrame = QImage();
     ui->videoLabel->set_selection_enabled(false);
-    ui->videoLabel->clear();
+    ui->videoLabel->clear_image();
     ui->originalVideoLabel->set_selection_enabled(false);
-    ui->originalVideoLabel->clear();
+    ui->originalVideoLabel->clear_image();
 }
 /**
 void MainWindow::exit_application()
@@ -2201,6 +2599,7 @@ void MainWindow::set_application_menu()
         ui->actionSaveProject->setEnabled(false);
 
     ui->actionNewObject->setEnabled(ui->newObjectButton->isEnabled());
+    ui->actionDetectObjects->setEnabled(ui->newObjectButton->isEnabled());
 
     if (ui->generalTab->isEnabled())
     {
@@ -2218,6 +2617,10 @@ void MainWindow::set_application_menu()
     ui->actionVideoEnd->setChecked(!isEndTimestampSet);
 
     ui->actionShowOriginalVideo->setChecked(showOriginalVideo);
+    ui->actionReducedTracking->setChecked(reducedTracking);
+    ui->actionForegroundGating->setChecked(foregroundGating);
+    ui->actionLumaTracking->setChecked(lumaTracking);
+    ui->actionMotionPrior->setChecked(motionPrior);
 
 }
 
@@ -2276,6 +2679,7 @@ void MainWindow::connect_signals()
 
     QObject::connect(ui->newObjectButton, SIGNAL(clicked()), this, SLOT(add_new_object()));
     QObject::connect(ui->actionNewObject, SIGNAL(triggered()), this, SLOT(add_new_object()));
+    QObject::connect(ui->actionDetectObjects, SIGNAL(triggered()), this, SLOT(detect_objects()));
 
 
     // OBJECT APPEARANCE TAB
@@ -2284,6 +2688,7 @@ void MainWindow::connect_signals()
     //handling defocusButton handles also colorButton since toggling colorButton switches off defocusButton
     QObject::connect(ui->defocusButton, SIGNAL(toggled(bool)), this, SLOT(change_defocus()));
     QObject::connect(ui->defocusSizeBox, SIGNAL(valueChanged(int)), this, SLOT(change_defocus_size()));
+    QObject::connect(ui->blurBox, SIGNAL(toggled(bool)), this, SLOT(change_blur()));
     QObject::connect(ui->drawInsideBox, SIGNAL(stateChanged(int)), this, SLOT(change_draw_inside()));
     QObject::connect(ui->drawBorderBox, SIGNAL(stateChanged(int)), this, SLOT(change_draw_border()));
     QObject::connect(ui->colorBox, SIGNAL(currentIndexChanged(int)), this, SLOT(change_color()));
@@ -2321,6 +2726,10 @@ void MainWindow::connect_signals()
     QObject::connect(ui->actionChangeName, SIGNAL(triggered()), this, SLOT(change_name()));
 
     QObject::connect(ui->removeObjectButton, SIGNAL(clicked()), this, SLOT(delete_object()));
+    QObject::connect(ui->trackingStrideBox, SIGNAL(valueChanged(int)), this, SLOT(change_tracking_stride()));
+    QObject::connect(ui->trackingPresetBox, SIGNAL(currentIndexChanged(int)), this, SLOT(change_tracking_preset()));
+    QObject::connect(ui->faceModeBox, SIGNAL(stateChanged(int)), this, SLOT(change_tracking_options()));
+    QObject::connect(ui->pcaModelBox, SIGNAL(stateChanged(int)), this, SLOT(change_tracking_options()));
     QObject::connect(ui->actionRemoveObject, SIGNAL(triggered()), this, SLOT(delete_object()));
 
 
@@ -2338,6 +2747,10 @@ void MainWindow::connect_signals()
     QObject::connect(ui->actionFrameNumbers, SIGNAL(triggered()), this, SLOT(display_frame_numbers()));
 
     QObject::connect(ui->actionShowOriginalVideo, SIGNAL(triggered()), this, SLOT(show_original_video()));
+    QObject::connect(ui->actionReducedTracking, SIGNAL(triggered()), this, SLOT(reduce_tracking_resolution()));
+    QObject::connect(ui->actionForegroundGating, SIGNAL(triggered()), this, SLOT(gate_by_foreground()));
+    QObject::connect(ui->actionLumaTracking, SIGNAL(triggered()), this, SLOT(track_luma_only()));
+    QObject::connect(ui->actionMotionPrior, SIGNAL(triggered()), this, SLOT(use_motion_prior()));
 
     // OTHERS
     QObject::connect(ui->videoFrame, SIGNAL(resized()), this, SLOT(reload_video_label()));
@@ -0,0 +1,497 @@
+/**
+ * @file markcompositor.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "markcompositor.h"
+#include "objectshape.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+namespace
+{
+    /**
+     * Runs a function for each index of a range in the threads of OpenCV.
+     */
+    class ParallelBody : public cv::ParallelLoopBody
+    {
+    public:
+        ParallelBody(std::function<void(int)> const &function) : function(function) { }
+
+        void operator()(cv::Range const &range) const
+        {
+            for (int i = range.start; i < range.end; i++)
+                function(i);
+        }
+
+    private:
+        std::function<void(int)> function;
+    };
+}
+
+MarkCompositor::MarkCompositor() :
+    tileCount(0),
+    lastTiles(0),
+    framesDrawn(0),
+    drawingTime(0)
+{
+}
+
+void MarkCompositor::set_tile_count(unsigned int count)
+{
+    tileCount = count;
+}
+
+void MarkCompositor::take_statistics(unsigned long &frames, double &averageTime, unsigned int &tiles)
+{
+    frames = framesDrawn;
+    averageTime = framesDrawn ? drawingTime / framesDrawn : 0;
+    tiles = lastTiles;
+
+    framesDrawn = 0;
+    drawingTime = 0;
+}
+
+bool MarkCompositor::add(TrackedObject const &object, int64_t timestamp)
+{
+    Mark mark;
+    if (!object.get_mark_position(timestamp, mark.position))
+        return false;
+
+    mark.appearance = object.get_appearance();
+    marks.push_back(mark);
+    return true;
+}
+
+void MarkCompositor::clear()
+{
+    marks.clear();
+}
+
+bool MarkCompositor::empty() const
+{
+    return marks.empty();
+}
+
+void MarkCompositor::compose(cv::Mat &frame, double scale)
+{
+    if (marks.empty())
+        return;
+
+    std::vector<PlaneMark> planeMarks;
+    for (auto const &mark: marks)
+    { // Important note: OpenCV uses BGR, not RGB
+        cv::Scalar borderColor(mark.appearance.borderColor.b, mark.appearance.borderColor.g, mark.appearance.borderColor.r, 255);
+        cv::Scalar color(mark.appearance.color.b, mark.appearance.color.g, mark.appearance.color.r, 255); // Opaque in BGRA frames
+        planeMarks.push_back(get_plane_mark(mark, scale, color, borderColor));
+    }
+
+    if (labels.empty())
+        labels.resize(1);
+
+    int64 start = cv::getTickCount();
+    compose_plane(frame, planeMarks, labels[0]);
+
+    framesDrawn++;
+    drawingTime += (cv::getTickCount() - start) * 1000. / cv::getTickFrequency();
+}
+
+void MarkCompositor::compose(std::vector<cv::Mat> &planes)
+{
+    assert(planes.size() == 3);
+
+    if (marks.empty())
+        return;
+
+    if (labels.size() < planes.size())
+        labels.resize(planes.size());
+
+    int64 start = cv::getTickCount();
+
+    for (unsigned int i = 0; i < planes.size(); i++)
+    { // Chroma planes are subsampled; the marks are scaled accordingly
+        double scale = static_cast<double>(planes[i].cols) / planes[0].cols;
+
+        std::vector<PlaneMark> planeMarks;
+        for (auto const &mark: marks)
+        {
+            cv::Scalar color = to_yuv(mark.appearance.color);
+            cv::Scalar borderColor = to_yuv(mark.appearance.borderColor);
+            planeMarks.push_back(get_plane_mark(mark, scale, cv::Scalar(color[i]), cv::Scalar(borderColor[i])));
+        }
+
+        compose_plane(planes[i], planeMarks, labels[i]);
+    }
+
+    framesDrawn++;
+    drawingTime += (cv::getTickCount() - start) * 1000. / cv::getTickFrequency();
+}
+
+MarkCompositor::PlaneMark MarkCompositor::get_plane_mark(Mark const &mark, double scale, cv::Scalar const &color,
+                                                         cv::Scalar const &borderColor) const
+{
+    PlaneMark planeMark;
+    planeMark.appearance = &mark.appearance;
+    planeMark.position = mark.position;
+    planeMark.position.x = std::lround(mark.position.x * scale);
+    planeMark.position.y = std::lround(mark.position.y * scale);
+    planeMark.position.width = std::lround(mark.position.width * scale);
+    planeMark.position.height = std::lround(mark.position.height * scale);
+    planeMark.color = color;
+    planeMark.borderColor = borderColor;
+    planeMark.defocusSize = std::max(1L, std::lround(mark.appearance.defocusSize * scale));
+    planeMark.borderThickness = mark.appearance.borderThickness > 0 ?
+                std::max(1L, std::lround(mark.appearance.borderThickness * scale)) : 0;
+
+    if (mark.appearance.defocus)
+    {
+        assert(mark.appearance.defocusSize > 0);
+        planeMark.effect = mark.appearance.blur ? BLUR : PIXELATE;
+    }
+    else
+        planeMark.effect = mark.appearance.drawInside ? FILL : NONE;
+
+    planeMark.visible = false;
+    return planeMark;
+}
+
+void MarkCompositor::compose_plane(cv::Mat &frame, std::vector<PlaneMark> &marks, cv::Mat &labels)
+{
+    assert(frame.depth() == CV_8U && frame.channels() <= 4);
+    assert(marks.size() < 65535);
+
+    if (labels.size() != frame.size())
+        labels = cv::Mat::zeros(frame.size(), CV_16UC1);
+
+    // Each pixel is labelled by the last mark covering it
+    cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+    for (unsigned int i = 0; i < marks.size(); i++)
+    {
+        PlaneMark &mark = marks[i];
+        Selection const &position = mark.position;
+
+        if (mark.effect == PIXELATE) // The shape is not taken into account
+            mark.area = cv::Rect(position.x - position.width/2, position.y - position.height/2, position.width, position.height);
+        else if (mark.effect != NONE)
+        { // Rasterized shapes may reach a pixel over their bounding box
+            cv::RotatedRect box(cv::Point2f(position.x, position.y), cv::Size2f(position.width, position.height), position.angle);
+            cv::Rect boundingBox = box.boundingRect();
+            mark.area = cv::Rect(boundingBox.x - 1, boundingBox.y - 1, boundingBox.width + 2, boundingBox.height + 2);
+        }
+        mark.area &= frameRect;
+
+        if (mark.area.area() > 0)
+            rasterize(labels, mark, i + 1);
+    }
+
+    // Only blocks and regions that stay visible are computed; they are read before anything is written
+    for (auto &mark: marks)
+    {
+        if (mark.effect == PIXELATE && mark.area.area() > 0)
+        {
+            int size = mark.defocusSize;
+            cv::Size blocksSize((mark.area.width + size - 1) / size, (mark.area.height + size - 1) / size);
+            mark.visibleBlocks = cv::Mat::zeros(blocksSize, CV_8UC1);
+            mark.blocks.create(blocksSize, frame.type());
+        }
+    }
+
+    int top = frame.rows;
+    int bottom = 0;
+    for (auto const &mark: marks)
+    {
+        if (mark.area.area() > 0)
+        {
+            top = std::min(top, mark.area.y);
+            bottom = std::max(bottom, mark.area.y + mark.area.height);
+        }
+    }
+
+    for_each_run(labels, marks, top, bottom, [&](int y, int begin, int end, int label)
+    {
+        PlaneMark &mark = marks[label - 1];
+        mark.visible = true;
+
+        if (mark.effect == PIXELATE)
+        {
+            int size = mark.defocusSize;
+            uchar *visibleBlocks = mark.visibleBlocks.ptr<uchar>((y - mark.area.y) / size);
+            for (int block = (begin - mark.area.x) / size; block <= (end - 1 - mark.area.x) / size; block++)
+                visibleBlocks[block] = 1;
+        }
+    });
+
+    cv::parallel_for_(cv::Range(0, marks.size()), ParallelBody([&](int i)
+    {
+        if (marks[i].visible && marks[i].effect == PIXELATE)
+            compute_blocks(frame, marks[i]);
+        else if (marks[i].visible && marks[i].effect == BLUR)
+            compute_blur(frame, marks[i]);
+    }));
+
+    // Every covered pixel is written once; tiles do not share any row
+    unsigned int tiles = tileCount;
+    if (!tiles)
+        tiles = std::max(1, std::min(cv::getNumThreads(), (bottom - top) / VIDEOTRACKING_COMPOSITOR_TILE_ROWS));
+    int tileRows = bottom > top ? (bottom - top + tiles - 1) / tiles : 0;
+    lastTiles = tiles;
+
+    int channels = frame.channels();
+    auto draw = [&](int y, int begin, int end, int label)
+    {
+        PlaneMark const &mark = marks[label - 1];
+        uchar *row = frame.ptr<uchar>(y);
+
+        if (mark.effect == FILL)
+        {
+            uchar color[4];
+            for (int c = 0; c < channels; c++)
+                color[c] = cv::saturate_cast<uchar>(mark.color[c]);
+
+            for (int x = begin; x < end; x++)
+                std::memcpy(row + x * channels, color, channels);
+        }
+        else if (mark.effect == PIXELATE)
+        {
+            int size = mark.defocusSize;
+            uchar const *blocks = mark.blocks.ptr<uchar>((y - mark.area.y) / size);
+            for (int x = begin; x < end; x++)
+                std::memcpy(row + x * channels, blocks + ((x - mark.area.x) / size) * channels, channels);
+        }
+        else if (mark.effect == BLUR)
+        {
+            uchar const *blurred = mark.blurred.ptr<uchar>(y - mark.area.y) + (begin - mark.area.x) * channels;
+            std::memcpy(row + begin * channels, blurred, (end - begin) * channels);
+        }
+    };
+
+    cv::parallel_for_(cv::Range(0, tiles), ParallelBody([&](int tile)
+    {
+        int firstRow = top + tile * tileRows;
+        for_each_run(labels, marks, firstRow, std::min(bottom, firstRow + tileRows), draw);
+    }));
+
+    // Borders are drawn in the same order; parts covered by the following marks' areas are restored
+    for (unsigned int i = 0; i < marks.size(); i++)
+    {
+        PlaneMark const &mark = marks[i];
+        if ((mark.effect != FILL && mark.effect != NONE) || !mark.appearance->drawBorder || mark.borderThickness <= 0)
+            continue;
+
+        cv::RotatedRect box(cv::Point2f(mark.position.x, mark.position.y),
+                            cv::Size2f(mark.position.width, mark.position.height), mark.position.angle);
+        cv::Rect boundingBox = box.boundingRect();
+        int margin = mark.borderThickness + 2; // Anti-aliased lines reach over their thickness
+        cv::Rect borderRect = cv::Rect(boundingBox.x - margin, boundingBox.y - margin,
+                                       boundingBox.width + 2*margin, boundingBox.height + 2*margin) & frameRect;
+
+        bool covered = false;
+        for (unsigned int j = i + 1; j < marks.size() && !covered; j++)
+            covered = (marks[j].area & borderRect).area() > 0;
+
+        if (!covered)
+        {
+            draw_border(frame, mark);
+            continue;
+        }
+
+        cv::Mat saved = frame(borderRect).clone();
+        draw_border(frame, mark);
+
+        cv::Mat coveredMask;
+        cv::compare(labels(borderRect), cv::Scalar(i + 1), coveredMask, cv::CMP_GT);
+        saved.copyTo(frame(borderRect), coveredMask);
+    }
+
+    for (auto const &mark: marks)
+    {
+        if (mark.area.area() > 0)
+            labels(mark.area).setTo(cv::Scalar(0));
+    }
+}
+
+void MarkCompositor::rasterize(cv::Mat &labels, PlaneMark const &mark, int label) const
+{
+    Selection const &position = mark.position;
+    cv::RotatedRect box(cv::Point2f(position.x, position.y), cv::Size2f(position.width, position.height), position.angle);
+
+    if (mark.effect == PIXELATE)
+        labels(mark.area).setTo(cv::Scalar(label));
+    else if (mark.effect == FILL)
+    {
+        if (mark.appearance->shape == ObjectShape::RECTANGLE)
+        {
+            cv::Point2f vertices2f[4];
+            cv::Point vertices[4];
+            box.points(vertices2f);
+            for (int i = 0; i < 4; i++)
+                vertices[i] = vertices2f[i];
+
+            cv::fillConvexPoly(labels, vertices, 4, cv::Scalar(label));
+        }
+        else if (mark.appearance->shape == ObjectShape::ELLIPSE)
+            cv::ellipse(labels, box, cv::Scalar(label), -1);
+    }
+    else if (mark.effect == BLUR)
+    { // The shape is rasterized relative to its bounding box so as the blurred pixels stay the same
+        cv::Rect region = box.boundingRect() & cv::Rect(0, 0, labels.cols, labels.rows);
+        if (region.area() == 0)
+            return;
+
+        cv::Mat mask = cv::Mat::zeros(region.size(), CV_8UC1);
+        cv::RotatedRect maskBox(box.center - cv::Point2f(region.x, region.y), box.size, box.angle);
+        if (mark.appearance->shape == ObjectShape::ELLIPSE)
+            cv::ellipse(mask, maskBox, cv::Scalar(255), -1);
+        else
+        {
+            cv::Point2f vertices2f[4];
+            cv::Point vertices[4];
+            maskBox.points(vertices2f);
+            for (int i = 0; i < 4; i++)
+                vertices[i] = vertices2f[i];
+
+            cv::fillConvexPoly(mask, vertices, 4, cv::Scalar(255));
+        }
+
+        labels(region).setTo(cv::Scalar(label), mask);
+    }
+}
+
+template<class Function>
+void MarkCompositor::for_each_run(cv::Mat const &labels, std::vector<PlaneMark> const &marks, int firstRow, int lastRow,
+                                  Function function) const
+{
+    // Columns of each row that are inside of an area; overlapping areas are merged
+    std::vector<std::pair<int, int>> spans;
+    for (int y = firstRow; y < lastRow; y++)
+    {
+        spans.clear();
+        for (auto const &mark: marks)
+        {
+            if (mark.area.area() > 0 && y >= mark.area.y && y < mark.area.y + mark.area.height)
+                spans.push_back(std::make_pair(mark.area.x, mark.area.x + mark.area.width));
+        }
+        std::sort(spans.begin(), spans.end());
+
+        unsigned short const *row = labels.ptr<unsigned short>(y);
+        for (unsigned int i = 0; i < spans.size(); )
+        {
+            int begin = spans[i].first;
+            int end = spans[i].second;
+            for (i++; i < spans.size() && spans[i].first <= end; i++)
+                end = std::max(end, spans[i].second);
+
+            for (int x = begin; x < end; )
+            {
+                int label = row[x];
+                int runEnd = x + 1;
+                while (runEnd < end && row[runEnd] == label)
+                    runEnd++;
+
+                if (label)
+                    function(y, x, runEnd, label);
+                x = runEnd;
+            }
+        }
+    }
+}
+
+void MarkCompositor::compute_blocks(cv::Mat const &frame, PlaneMark &mark) const
+{
+    int channels = frame.channels();
+    int size = mark.defocusSize;
+    cv::Rect const &area = mark.area;
+
+    // Sum of each block is read from four corners of the integral image; sums of whole frames fit a double exactly
+    cv::Mat sums;
+    cv::integral(frame(area), sums, CV_64F);
+
+    for (int blockRow = 0; blockRow < mark.blocks.rows; blockRow++)
+    {
+        int top = blockRow * size;
+        int bottom = std::min(top + size, area.height); // Do not cross the object's border
+        double const *upperSums = sums.ptr<double>(top);
+        double const *lowerSums = sums.ptr<double>(bottom);
+        uchar const *visibleBlocks = mark.visibleBlocks.ptr<uchar>(blockRow);
+        uchar *blocks = mark.blocks.ptr<uchar>(blockRow);
+
+        for (int block = 0; block < mark.blocks.cols; block++)
+        {
+            if (!visibleBlocks[block])
+                continue;
+
+            int left = block * size;
+            int right = std::min(left + size, area.width);
+
+            double scale = 1. / ((right - left) * (bottom - top)); // The same rounding as cv::mean()
+            for (int c = 0; c < channels; c++)
+            {
+                double sum = lowerSums[right * channels + c] - lowerSums[left * channels + c]
+                        - upperSums[right * channels + c] + upperSums[left * channels + c];
+                blocks[block * channels + c] = cv::saturate_cast<uchar>(sum * scale);
+            }
+        }
+    }
+}
+
+void MarkCompositor::compute_blur(cv::Mat const &frame, PlaneMark &mark) const
+{
+    Selection const &position = mark.position;
+    cv::RotatedRect box(cv::Point2f(position.x, position.y), cv::Size2f(position.width, position.height), position.angle);
+    cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+    cv::Rect region = box.boundingRect() & frameRect;
+
+    // The blur reads pixels up to its radius around the region; the area is inside of it
+    int radius = mark.defocusSize;
+    cv::Rect source = cv::Rect(region.x - radius, region.y - radius, region.width + 2*radius, region.height + 2*radius) & frameRect;
+    assert((source & mark.area) == mark.area);
+    double sigma = radius / VIDEOTRACKING_BLUR_KERNEL_SIGMAS;
+
+    // GaussianBlur() filters rows and columns separately
+    cv::Mat blurred;
+    int factor = sigma / VIDEOTRACKING_BLUR_MAX_SIGMA;
+    if (factor > 1)
+    { // The kernel would be too long; blur a scaled down copy instead
+        cv::Mat scaled;
+        cv::resize(frame(source), scaled, cv::Size(std::max(1, source.width / factor), std::max(1, source.height / factor)),
+                   0, 0, cv::INTER_AREA);
+        cv::GaussianBlur(scaled, scaled, cv::Size(), sigma / factor, sigma / factor, cv::BORDER_REPLICATE);
+        cv::resize(scaled, blurred, source.size(), 0, 0, cv::INTER_LINEAR);
+    }
+    else
+        cv::GaussianBlur(frame(source), blurred, cv::Size(), sigma, sigma, cv::BORDER_REPLICATE);
+
+    mark.blurred = blurred(cv::Rect(mark.area.x - source.x, mark.area.y - source.y, mark.area.width, mark.area.height));
+}
+
+void MarkCompositor::draw_border(cv::Mat &frame, PlaneMark const &mark) const
+{
+    cv::RotatedRect rectangle = cv::RotatedRect(cv::Point2f(mark.position.x, mark.position.y),
+                                                cv::Size2f(mark.position.width, mark.position.height), mark.position.angle);
+
+    if (mark.appearance->shape == ObjectShape::RECTANGLE)
+    {
+        cv::Point2f vertices2f[4];
+        rectangle.points(vertices2f);
+
+        for (int i = 0; i < 4; i++)
+            cv::line(frame, vertices2f[i], vertices2f[(i+1)%4], mark.borderColor, mark.borderThickness, CV_AA);
+    }
+    else if (mark.appearance->shape == ObjectShape::ELLIPSE)
+        cv::ellipse(frame, rectangle, mark.borderColor, mark.borderThickness);
+}
+
+cv::Scalar MarkCompositor::to_yuv(ObjectColor const &color)
+{
+    // ITU-R BT.601 limited range; the same as swscale uses for the output format
+    double y = 16 + 0.257 * color.r + 0.504 * color.g + 0.098 * color.b;
+    double u = 128 - 0.148 * color.r - 0.291 * color.g + 0.439 * color.b;
+    double v = 128 + 0.439 * color.r - 0.368 * color.g - 0.071 * color.b;
+
+    return cv::Scalar(cvRound(y), cvRound(u), cvRound(v));
+}
@@ -0,0 +1,69 @@
+/**
+ * @file objectdetector.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "objectdetector.h"
+
+#include <QDebug>
+#include <cmath>
+
+ObjectDetector::ObjectDetector()
+{
+    detectionTime = 0;
+    detectedFrames = 0;
+}
+
+bool ObjectDetector::load(std::string const &cascadeFile)
+{
+    if (!classifier.load(cascadeFile))
+    {
+        qDebug() << "ERROR-ObjectDetector: Cannot load cascade" << QString::fromStdString(cascadeFile);
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<Selection> ObjectDetector::detect(cv::Mat const &frame)
+{
+    std::vector<Selection> detections;
+    if (classifier.empty())
+        return detections;
+
+    int64 start = cv::getTickCount();
+
+    double scale = 1;
+    cv::Mat gray;
+    cv::cvtColor(frame, gray, CV_BGR2GRAY);
+    if (gray.rows > VIDEOTRACKING_DETECTION_HEIGHT)
+    {
+        scale = static_cast<double>(gray.rows) / VIDEOTRACKING_DETECTION_HEIGHT;
+        cv::resize(gray, gray, cv::Size(std::lround(gray.cols / scale), VIDEOTRACKING_DETECTION_HEIGHT), 0, 0, cv::INTER_AREA);
+    }
+    cv::equalizeHist(gray, gray);
+
+    std::vector<cv::Rect> objects;
+    classifier.detectMultiScale(gray, objects, 1.1, 3, 0,
+                                cv::Size(VIDEOTRACKING_DETECTION_MIN_SIZE, VIDEOTRACKING_DETECTION_MIN_SIZE));
+
+    for (cv::Rect const &object: objects)
+        detections.emplace_back(std::lround(object.x * scale), std::lround(object.y * scale),
+                                std::lround(object.width * scale), std::lround(object.height * scale));
+
+    detectionTime += (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+    detectedFrames++;
+
+    return detections;
+}
+
+double ObjectDetector::get_detection_time() const
+{
+    return detectionTime;
+}
+
+unsigned long ObjectDetector::get_detected_frames() const
+{
+    return detectedFrames;
+}
@@ -0,0 +1,24 @@
+/**
+ * @file projectformat.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "projectformat.h"
+
+std::uint32_t ProjectFormat::loadedFormat = VIDEOTRACKING_PROJECT_FORMAT;
+
+ProjectFormat::ProjectFormat(std::uint32_t format)
+{
+    loadedFormat = format;
+}
+
+ProjectFormat::~ProjectFormat()
+{
+    loadedFormat = VIDEOTRACKING_PROJECT_FORMAT;
+}
+
+std::uint32_t ProjectFormat::get()
+{
+    return loadedFormat;
+}
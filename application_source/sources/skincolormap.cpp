@@ -0,0 +1,52 @@
+/**
+ * @file skincolormap.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "skincolormap.h"
+
+#include <algorithm>
+
+SkinColorMap::SkinColorMap()
+{
+}
+
+void SkinColorMap::update(cv::Mat const &frame, cv::Rect const &newRegion)
+{
+    region = newRegion & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (region.width < VIDEOTRACKING_SKIN_SCALE || region.height < VIDEOTRACKING_SKIN_SCALE)
+    {
+        region = cv::Rect();
+        return;
+    }
+
+    cv::resize(frame(region), small, cv::Size(region.width / VIDEOTRACKING_SKIN_SCALE, region.height / VIDEOTRACKING_SKIN_SCALE),
+               0, 0, cv::INTER_AREA);
+
+    cv::cvtColor(small, ycrcb, CV_BGR2YCrCb);
+    cv::inRange(ycrcb, cv::Scalar(0, VIDEOTRACKING_SKIN_CR_MIN, VIDEOTRACKING_SKIN_CB_MIN),
+                cv::Scalar(255, VIDEOTRACKING_SKIN_CR_MAX, VIDEOTRACKING_SKIN_CB_MAX), mask);
+    cv::min(mask, 1, mask); // inRange() sets 255
+
+    cv::integral(mask, integralMask, CV_32S);
+}
+
+double SkinColorMap::get_skin_ratio(cv::Rect const &box) const
+{
+    if (region.area() <= 0)
+        return 0;
+
+    int x1 = std::max(0, (box.x - region.x) / VIDEOTRACKING_SKIN_SCALE);
+    int y1 = std::max(0, (box.y - region.y) / VIDEOTRACKING_SKIN_SCALE);
+    int x2 = std::min(mask.cols, (box.x + box.width - region.x) / VIDEOTRACKING_SKIN_SCALE);
+    int y2 = std::min(mask.rows, (box.y + box.height - region.y) / VIDEOTRACKING_SKIN_SCALE);
+
+    if (x2 <= x1 || y2 <= y1)
+        return 0; // Box is outside of the region
+
+    int sum = integralMask.at<int>(y2, x2) - integralMask.at<int>(y1, x2) -
+            integralMask.at<int>(y2, x1) + integralMask.at<int>(y1, x1);
+
+    return static_cast<double>(sum) / ((x2 - x1) * (y2 - y1));
+}
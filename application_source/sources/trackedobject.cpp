@@ -6,16 +6,29 @@
 
 #include "trackedobject.h"
 #include <QDebug>
-#include "objectshape.h"
+
+#include <cmath>
+#include <algorithm>
 
 // Only currentSection can have initialized trackingAlgorithm so as memory can be correctly freed
 
+std::atomic<unsigned long> TrackedObject::lastRevision(0);
+
 TrackedObject::TrackedObject()
 { // CEREAL uses this constructor
     endTimestampSet = false;
     currentSection = nullptr;
     nextSection = false;
     allProcessed = false;
+    trackingStride = 1;
+    strideFallback = false;
+    reliableFrames = 0;
+    endedBySceneCut = false;
+    sceneCutTimestamp = 0;
+    sceneCutTimePosition = 0;
+    sceneCutFrameNumber = 0;
+    ignoredSceneCutFrame = 0;
+    revision = new_revision();
     qDebug() << "new trackedObject";
 }
 
@@ -37,6 +50,15 @@ TrackedObject::TrackedObject(const Characteristics &appearance, std::string obje
     currentSection = nullptr;
     nextSection = false;
     allProcessed = false;
+    trackingStride = 1;
+    strideFallback = false;
+    reliableFrames = 0;
+    endedBySceneCut = false;
+    sceneCutTimestamp = 0;
+    sceneCutTimePosition = 0;
+    sceneCutFrameNumber = 0;
+    ignoredSceneCutFrame = 0;
+    revision = new_revision();
     //lastProcessedTimestamp = -1;
     //lastProcessedTimestamp = VIDEOTRACKING_NOTHING_PROCESSED;
 }
@@ -74,6 +96,8 @@ void TrackedObject::add_section(int64_t initialTimestamp, Selection const &initi
 // If oldTimeSet==true, oldTimestamp is valid and updating is done, otherwise adding is done
 bool TrackedObject::set_trajectory_section(int64_t newTimestamp, Selection position, unsigned long timePosition, unsigned long frameNumber)
 {
+    revision = new_revision();
+    trajectory.invalidate(); // Frames tracked backward from the Beginning may change
     if (endTimestampSet && endTimestamp < newTimestamp)
         return false; // Section cannot begin after the end of the tracking period
     else if (trajectorySections.find(newTimestamp) != trajectorySections.end())
@@ -85,6 +109,14 @@ bool TrackedObject::set_trajectory_section(int64_t newTimestamp, Selection posit
 
     add_section(newTimestamp, position, timePosition, frameNumber);
 
+    auto followingSection = trajectorySections.upper_bound(newTimestamp);
+    if (followingSection != trajectorySections.end())
+    { // Frames tracked backward from the following section up to this one now belong to this section
+        auto &backwardTrajectory = followingSection->second.backwardTrajectory;
+        backwardTrajectory.erase(backwardTrajectory.begin(), backwardTrajectory.upper_bound(newTimestamp));
+    }
+
+    clear_scene_cut(); // A following section overrides the detection
     allProcessed = false;
     int64_t lastProcessedTimestamp;
     bool lastProcessedTimestampSet = get_last_processed_timestamp(lastProcessedTimestamp);
@@ -128,6 +160,9 @@ bool TrackedObject::set_trajectory_section(int64_t newTimestamp, Selection posit
         // Only nextSectionTimestamp may need to be updated if the newly added section is the next one.
 
         // The newly added is already in trajectorySections, so let it find the appropriate one itself
+        if (!currentSection)
+            return true; // track_next() finds the sections itself
+
         auto nextSectionIterator = trajectorySections.upper_bound(currentSection->initialTimestamp);
         if (nextSectionIterator != trajectorySections.end())
         {
@@ -143,6 +178,8 @@ bool TrackedObject::set_trajectory_section(int64_t newTimestamp, Selection posit
 
 bool TrackedObject::change_trajectory_section(int64_t oldTimestamp, int64_t newTimestamp, Selection position, unsigned long timePosition, unsigned long frameNumber)
 {
+    revision = new_revision();
+    trajectory.invalidate(); // Frames tracked backward from the Beginning may change
     // The oldTimestamp needs to exist
     assert(trajectorySections.find(oldTimestamp) != trajectorySections.end());
 
@@ -161,6 +198,7 @@ bool TrackedObject::change_trajectory_section(int64_t oldTimestamp, int64_t newT
 
     currentSection = nullptr; // let track_next() to find correct currentSection and nextSection
     nextSection = false;
+    clear_scene_cut();
     allProcessed = false;
 
     auto oldSection = trajectorySections.find(oldTimestamp);
@@ -187,8 +225,8 @@ bool TrackedObject::change_trajectory_section(int64_t oldTimestamp, int64_t newT
         if (newTimestamp < initialTimestamp) // This section begins before the BEGINNING section. Therefore, set this section as beginning.
             initialTimestamp = newTimestamp;
 
-        if (oldTimestamp < newTimestamp)
-        { // Section is updated to begin later
+        if (oldTimestamp < newTimestamp || !oldSection->second.backwardTrajectory.empty())
+        { // Section is updated to begin later or the previous section's trajectory contains frames tracked backward from it
 
             // V tomhle pripade je treba, aby bylo z trajectory odstraneno vsechno pocinaje
             // zacatku PREDCHOZI sekce od oldTimestamp. To z toho duvodu, ze od oldTimestamp
@@ -222,6 +260,8 @@ bool TrackedObject::change_trajectory_section(int64_t oldTimestamp, int64_t newT
 /* If false return: Beginning section cannot be deleted */
 bool TrackedObject::delete_trajectory_section(int64_t timestamp)
 {
+    revision = new_revision();
+    trajectory.invalidate(); // Frames tracked backward from the Beginning may change
     if (timestamp == initialTimestamp) // Beginning section cannot be deleted
     {
         qDebug() << "Beginning section cannot be deleted";
@@ -253,6 +293,7 @@ bool TrackedObject::delete_trajectory_section(int64_t timestamp)
         else
             nextSection = false;
     }
+    clear_scene_cut();
     allProcessed = false;
 
     // previousSection always exists as Beginning section cannot be deleted.
@@ -273,6 +314,12 @@ bool TrackedObject::delete_trajectory_section(int64_t timestamp)
  */
 bool TrackedObject::change_end_frame(bool set, int64_t timestamp, unsigned long timePosition, unsigned long frameNumber)
 {
+    revision = new_revision();
+    if (set && endedBySceneCut && timestamp < sceneCutTimestamp)
+        endedBySceneCut = false; // The object ends before the cut; the trajectory after the end is erased below
+    else
+        clear_scene_cut(); // The cut is detected again if the object is still tracked over it
+
     if (!set)
     { // Tracking till the end of the video
 
@@ -341,6 +388,7 @@ bool TrackedObject::change_end_frame(bool set, int64_t timestamp, unsigned long
 
 void TrackedObject::change_appearance(Characteristics const &newAppearance)
 {
+    revision = new_revision();
     appearance = newAppearance;
 }
 
@@ -353,7 +401,7 @@ Characteristics TrackedObject::get_appearance() const
 
 // All changes to trajectorySections make currentSection==nullptr and nextSection=false, so
 // track_next() needs to find appropriate values
-Selection TrackedObject::track_next(VideoFrame const *frame)
+Selection TrackedObject::track_next(VideoFrame const *frame, double timeBudget)
 {
     if (!currentSection || (nextSection && frame->get_timestamp() >= nextSectionTimestamp))
     { // Enters new section
@@ -408,17 +456,128 @@ Selection TrackedObject::track_next(VideoFrame const *frame)
         Selection centerizedPosition;
 
 
+        // The tracking frame may be scaled; the algorithm works in its coordinates
         currentSection->trackingAlgorithm = new TrackingAlgorithm(*(frame->get_mat_frame()),
-                                                            currentSection->initialPosition, centerizedPosition);
+                                                                  frame->to_frame_coordinates(currentSection->initialPosition),
+                                                                  trackingParameters, centerizedPosition);
+        centerizedPosition = frame->to_source_coordinates(centerizedPosition);
+
+        trajectory.set(frame->get_timestamp(), TrajectoryEntry(centerizedPosition, frame->get_time_position(),
+                                                               frame->get_frame_number()));
 
-        trajectory[frame->get_timestamp()] = TrajectoryEntry(centerizedPosition, frame->get_time_position(), frame->get_frame_number());
+        lastTrackedTimestamp = frame->get_timestamp();
+        lastTrackedFrameNumber = frame->get_frame_number();
+        lastTrackedPosition = centerizedPosition;
+        strideFallback = false;
+        reliableFrames = 0;
+        lastHistogram = compute_histogram(frame);
 
         return centerizedPosition;
     }
 
-    Selection result = currentSection->trackingAlgorithm->track_next_frame(*(frame->get_mat_frame()));
+    if (nextSection)
+    { // Frames that were tracked backward from the next section are not tracked again; the passes meet here
+        auto const &backwardTrajectory = trajectorySections.at(nextSectionTimestamp).backwardTrajectory;
+        auto backwardEntry = backwardTrajectory.find(frame->get_timestamp());
+        if (backwardEntry != backwardTrajectory.end())
+        {
+            TrajectoryEntry const &entry = backwardEntry->second;
+            trajectory.set(frame->get_timestamp(), entry);
+
+            if (frame->get_frame_number() - lastTrackedFrameNumber > 1)
+                interpolate_skipped(entry.position, frame->get_frame_number());
+
+            lastTrackedTimestamp = frame->get_timestamp();
+            lastTrackedFrameNumber = frame->get_frame_number();
+            lastTrackedPosition = entry.position;
+            lastHistogram = cv::Mat(); // Not compared across the meeting point
 
-    trajectory[frame->get_timestamp()] = TrajectoryEntry(result, frame->get_time_position(), frame->get_frame_number());
+            return entry.position;
+        }
+    }
+
+    if (!is_stride_frame(frame))
+    { // Skipped frame; the position is interpolated when the next frame is tracked
+        trajectory.set(frame->get_timestamp(), TrajectoryEntry(lastTrackedPosition, frame->get_time_position(),
+                                                               frame->get_frame_number(), true));
+        return lastTrackedPosition;
+    }
+
+    unsigned long step = frame->get_frame_number() - lastTrackedFrameNumber;
+    currentSection->trackingAlgorithm->set_frame_step(step);
+    currentSection->trackingAlgorithm->set_time_budget(timeBudget);
+
+    double dx, dy;
+    cv::Rect box(lastTrackedPosition.x - lastTrackedPosition.width/2, lastTrackedPosition.y - lastTrackedPosition.height/2,
+                 lastTrackedPosition.width, lastTrackedPosition.height);
+    if (frame->get_motion(box, dx, dy))
+    { // Motion vectors describe one frame; skipped frames are expected to move alike
+        double scaleX = static_cast<double>(frame->get_width()) / frame->get_source_width();
+        double scaleY = static_cast<double>(frame->get_height()) / frame->get_source_height();
+        currentSection->trackingAlgorithm->set_motion_prior(dx * step * scaleX, dy * step * scaleY);
+    }
+
+    currentSection->trackingAlgorithm->set_foreground_mask(frame->get_foreground_mask());
+
+    Selection result = frame->to_source_coordinates(currentSection->trackingAlgorithm->track_next_frame(*(frame->get_mat_frame())));
+
+    // The box of the last position is compared with the last frame only if the object seems lost;
+    // lastTrackedPosition still holds the last position
+    cv::Mat histogram;
+    if (!nextSection && !lastHistogram.empty() && frame->get_frame_number() > ignoredSceneCutFrame &&
+            currentSection->trackingAlgorithm->get_match_error() > VIDEOTRACKING_CUT_MAX_ERROR)
+        histogram = compute_histogram(frame);
+
+    if (!histogram.empty() &&
+            cv::compareHist(histogram, lastHistogram, CV_COMP_BHATTACHARYYA) > VIDEOTRACKING_CUT_HISTOGRAM_DISTANCE)
+    { // Scene cut; the object is not in the new scene. Following sections set by the user override the detection.
+      // The cut is only marked; the end frame set by the user is kept
+        set_all_processed(true);
+        endedBySceneCut = true;
+        sceneCutTimestamp = frame->get_timestamp();
+        sceneCutTimePosition = frame->get_time_position();
+        sceneCutFrameNumber = frame->get_frame_number();
+        lastHistogram = cv::Mat();
+
+        return lastTrackedPosition;
+    }
+
+    TrajectoryEntry &entry = trajectory.set(frame->get_timestamp(),
+                                            TrajectoryEntry(result, frame->get_time_position(), frame->get_frame_number(),
+                                                            false, currentSection->trackingAlgorithm->is_degraded()));
+    entry.set_telemetry(*(currentSection->trackingAlgorithm));
+
+    if (step > 1)
+        interpolate_skipped(result, frame->get_frame_number());
+
+    if (trackingStride > 1)
+    { // Check whether the sparse tracking is reliable
+        double displacement = std::sqrt(std::pow(result.x - lastTrackedPosition.x, 2.0) + std::pow(result.y - lastTrackedPosition.y, 2.0));
+        double maxDisplacement = VIDEOTRACKING_STRIDE_MAX_DISPLACEMENT * std::min(result.width, result.height);
+        bool reliable = currentSection->trackingAlgorithm->get_match_error() <= VIDEOTRACKING_STRIDE_MAX_ERROR;
+
+        if (strideFallback)
+        { // Resume sparse tracking when the object would not move too much during a whole stride
+            if (reliable && displacement * trackingStride <= maxDisplacement)
+                reliableFrames++;
+            else
+                reliableFrames = 0;
+
+            if (reliableFrames >= VIDEOTRACKING_STRIDE_RECOVERY * trackingStride)
+                strideFallback = false;
+        }
+        else if (!reliable || displacement > maxDisplacement)
+        { // Skipped frames are interpolated anyway as they cannot be tracked again
+            qDebug() << "Sparse tracking falls back to tracking every frame";
+            strideFallback = true;
+            reliableFrames = 0;
+        }
+    }
+
+    lastTrackedTimestamp = frame->get_timestamp();
+    lastTrackedFrameNumber = frame->get_frame_number();
+    lastTrackedPosition = result;
+    lastHistogram = compute_histogram(frame); // The only histogram computed in most frames
 
 
     int64_t lastProcessedTimestamp;
@@ -430,113 +589,159 @@ Selection TrackedObject::track_next(VideoFrame const *frame)
     return result;
 }
 
-bool TrackedObject::get_position(int64_t timestamp, Selection &trackedPosition) const
+bool TrackedObject::is_ended_by_scene_cut() const
 {
-    try
-    {
-        trackedPosition = trajectory.at(timestamp).position; // Throws an exception, when trajectory with given timestamp does not exist
-    } catch (std::out_of_range) {
+    return endedBySceneCut;
+}
+
+bool TrackedObject::get_scene_cut(int64_t &timestamp, unsigned long &timePosition, unsigned long &frameNumber) const
+{
+    if (!endedBySceneCut)
         return false;
-    }
 
+    timestamp = sceneCutTimestamp;
+    timePosition = sceneCutTimePosition;
+    frameNumber = sceneCutFrameNumber;
     return true;
 }
 
-bool TrackedObject::draw_mark(cv::Mat &frame, cv::Mat const &originalFrame, int64_t timestamp) const
+bool TrackedObject::is_after_scene_cut(int64_t timestamp) const
 {
-    //qDebug()<< "Draw mark";
+    return endedBySceneCut && sceneCutTimestamp <= timestamp;
+}
 
-    Selection position;
-    try
-    {
-        position = trajectory.at(timestamp).position; // Throws an exception, when trajectory with given timestamp does not exist
-    } catch (std::out_of_range) {
+bool TrackedObject::ignore_scene_cut()
+{
+    if (!endedBySceneCut)
         return false;
-    }
 
-    if (appearance.defocus)
-    {
-        assert(appearance.defocusSize > 0);
-
-        //cv::Mat3b roiMat = imgMat(cv::Rect(hSt,vSt,hEn,vEn));
-        unsigned long x = position.x - position.width/2;
-        unsigned long y = position.y - position.height/2;
-        unsigned long xMax = position.width + x;
-        unsigned long yMax = position.height + y;
-
-        // This secures valid values
-        unsigned long cols = frame.cols;
-        unsigned long rows = frame.rows;
-        if (xMax > cols)
-            xMax = cols;
-        if (yMax > rows)
-            yMax = rows;
-
-        unsigned long i, j;
-        unsigned long currentSquareWidth, currentSquareHeight;
-        cv::Rect roiRect;
-        cv::Mat roi;
-        cv::Scalar mean;
-        for (i=x; i < xMax; i+=appearance.defocusSize)
-        {
-            for (j=y; j < yMax; j+=appearance.defocusSize)
-            {
-                currentSquareWidth = appearance.defocusSize;
-                currentSquareHeight = appearance.defocusSize;
-
-                if (i+currentSquareWidth > xMax) // Do not cross the object's border
-                    currentSquareWidth = xMax - i;
-
-                if (j+currentSquareHeight > yMax) // Do not cross the object's border
-                    currentSquareHeight = yMax - j;
-
-                // Width and height must not be 0 for roi to be created
-                if (currentSquareWidth > 0 && currentSquareHeight > 0)
-                {
-                    roiRect = cv::Rect(i, j, currentSquareWidth, currentSquareHeight);
-                    roi = originalFrame(roiRect); // originalFrame is used so as it does not involve other tracked objects
-                    mean = cv::mean(roi);
-                    cv::rectangle(frame, roiRect, mean, CV_FILLED);
-                }
-            }
-        }
+    revision = new_revision();
+    ignoredSceneCutFrame = sceneCutFrameNumber;
+    clear_scene_cut();
+    return true;
+}
 
+void TrackedObject::clear_scene_cut()
+{
+    if (!endedBySceneCut)
+        return;
+
+    endedBySceneCut = false;
+    allProcessed = false;
+
+    int64_t lastProcessedTimestamp;
+    if (!get_last_processed_timestamp(lastProcessedTimestamp))
+        return;
+
+    // The section's tracking algorithm needs to go from its beginning to have the correct data
+    auto section = --(trajectorySections.upper_bound(lastProcessedTimestamp));
+    trajectory.erase(trajectory.find(section->first), trajectory.end());
+}
+
+unsigned long TrackedObject::get_revision() const
+{
+    return revision;
+}
+
+unsigned long TrackedObject::new_revision()
+{
+    return ++lastRevision;
+}
+
+cv::Mat TrackedObject::compute_histogram(VideoFrame const *frame) const
+{
+    cv::Mat const *matFrame = frame->get_mat_frame();
+    Selection position = frame->to_frame_coordinates(lastTrackedPosition);
+
+    // Object's box lies within the search region, so it is converted even when the frame is converted partially
+    cv::Rect box(position.x - position.width/2, position.y - position.height/2, position.width, position.height);
+    box &= cv::Rect(0, 0, matFrame->cols, matFrame->rows);
+    if (box.area() == 0)
+        return cv::Mat();
+
+    cv::Mat thumbnail;
+    cv::resize((*matFrame)(box), thumbnail, cv::Size(VIDEOTRACKING_CUT_THUMBNAIL, VIDEOTRACKING_CUT_THUMBNAIL), 0, 0, cv::INTER_AREA);
+
+    // Luma-only frames have a single channel; it gets finer bins instead
+    int const channels[] = {0, 1, 2};
+    int const bins[] = {4, 4, 4};
+    int const lumaBins[] = {16};
+    float const range[] = {0, 256};
+    float const *ranges[] = {range, range, range};
+
+    cv::Mat histogram;
+    if (thumbnail.channels() == 1)
+        cv::calcHist(&thumbnail, 1, channels, cv::Mat(), histogram, 1, lumaBins, ranges);
+    else
+        cv::calcHist(&thumbnail, 1, channels, cv::Mat(), histogram, 3, bins, ranges);
+    cv::normalize(histogram, histogram, 1, 0, cv::NORM_L1);
+
+    return histogram;
+}
+
+cv::Rect TrackedObject::get_search_region(VideoFrame const *frame) const
+{
+    if (allProcessed || !currentSection || !currentSection->trackingAlgorithm || !frame->get_width())
+        return cv::Rect(); // The section of the next frame is not known yet
+
+    // Noise of the particles is in tracking frame pixels and grows with the number of skipped frames
+    double scale = static_cast<double>(frame->get_source_width()) / frame->get_width();
+    unsigned int step = strideFallback ? 1 : trackingStride;
+    double spread = VIDEOTRACKING_SEARCH_NOISE_SPREAD * std::max(trackingParameters.noiseX, trackingParameters.noiseY) *
+            step * scale;
+
+    // Rotated object fits into a circle
+    double radius = std::sqrt(std::pow(lastTrackedPosition.width, 2.0) + std::pow(lastTrackedPosition.height, 2.0)) / 2;
+    double margin = radius * (1 + VIDEOTRACKING_SEARCH_MARGIN) + spread;
+    cv::Rect region(lastTrackedPosition.x - margin, lastTrackedPosition.y - margin, 2 * margin, 2 * margin);
+
+    if (nextSection)
+    { // The next frame may begin the next section; its reference is taken from the initial position
+        Selection const &initialPosition = trajectorySections.at(nextSectionTimestamp).initialPosition;
+        region |= cv::Rect(initialPosition.x, initialPosition.y, initialPosition.width, initialPosition.height);
     }
-    else // Fill and/or border; not defocus
-    {
-        cv::RotatedRect rectangle = cv::RotatedRect(cv::Point2f(position.x, position.y), cv::Size2f(position.width, position.height), position.angle);
 
-        // Important note: OpenCV uses BGR, not RGB
-        cv::Scalar borderColor(appearance.borderColor.b, appearance.borderColor.g, appearance.borderColor.r);
-        cv::Scalar color(appearance.color.b, appearance.color.g, appearance.color.r);
+    return region;
+}
 
-        if (appearance.shape == ObjectShape::RECTANGLE)
-        {
-            cv::Point2f vertices2f[4];
-            cv::Point vertices[4];
-            rectangle.points(vertices2f);
-            for (int i = 0; i < 4; i++)
-                vertices[i] = vertices2f[i];
+bool TrackedObject::get_position(int64_t timestamp, Selection &trackedPosition) const
+{
+    TrajectoryEntry const *entry = find_entry(timestamp);
+    if (!entry)
+        return false;
 
-            if (appearance.drawInside)
-                cv::fillConvexPoly(frame, vertices, 4, color);
+    trackedPosition = entry->position;
+    return true;
+}
 
+TrajectoryEntry const *TrackedObject::find_entry(int64_t timestamp) const
+{
+    auto iterator = trajectory.find(timestamp);
+    if (iterator != trajectory.end())
+        return &(iterator->second);
+
+    if (timestamp < initialTimestamp && !trajectorySections.empty())
+    { // Frames preceding the Beginning section are stored only in the section
+        auto const &backwardTrajectory = trajectorySections.begin()->second.backwardTrajectory;
+        auto backwardIterator = backwardTrajectory.find(timestamp);
+        if (backwardIterator != backwardTrajectory.end())
+            return &(backwardIterator->second);
+    }
 
-            if (appearance.drawBorder && appearance.borderThickness > 0)
-            {
-                for (int i = 0; i < 4; i++)
-                    cv::line(frame, vertices2f[i], vertices2f[(i+1)%4], borderColor, appearance.borderThickness, CV_AA);
-            }
-        }
-        else if (appearance.shape == ObjectShape::ELLIPSE)
-        {
-            if (appearance.drawInside)
-                cv::ellipse(frame,rectangle, color, -1);
+    return nullptr;
+}
 
-            if (appearance.drawBorder && appearance.borderThickness > 0)
-                cv::ellipse(frame,rectangle, borderColor, appearance.borderThickness);
+bool TrackedObject::get_mark_position(int64_t timestamp, Selection &position) const
+{
+    TrajectoryEntry const *entry = find_entry(timestamp);
+    if (!entry)
+        return false;
 
-        }
+    position = entry->position;
+    if (entry->interpolated)
+    { // Interpolated position is less accurate; enlarge the mark so it still covers the object
+        position.width += position.width * VIDEOTRACKING_INTERPOLATED_MARGIN;
+        position.height += position.height * VIDEOTRACKING_INTERPOLATED_MARGIN;
     }
 
     return true;
@@ -547,7 +752,7 @@ std::map<int64_t, TrajectorySection> const &TrackedObject::get_trajectory_sectio
     return trajectorySections;
 }
 
-std::map<int64_t, TrajectoryEntry> const &TrackedObject::get_trajectory() const
+Trajectory const &TrackedObject::get_trajectory() const
 {
     return trajectory;
 }
@@ -557,6 +762,18 @@ int64_t TrackedObject::get_initial_timestamp() const
     return initialTimestamp;
 }
 
+int64_t TrackedObject::get_first_timestamp() const
+{
+    if (!trajectorySections.empty())
+    {
+        auto const &backwardTrajectory = trajectorySections.begin()->second.backwardTrajectory;
+        if (!backwardTrajectory.empty() && backwardTrajectory.begin()->first < initialTimestamp)
+            return backwardTrajectory.begin()->first;
+    }
+
+    return initialTimestamp;
+}
+
 int64_t TrackedObject::get_end_timestamp() const
 {
     return endTimestamp;
@@ -630,9 +847,18 @@ bool TrackedObject::set_name(std::string newName)
 
 void TrackedObject::erase_trajectory_to_comply()
 {
+    revision = new_revision();
     if (allProcessed) // Everything is already processed, sections are not needed anymore
         return;
 
+    if (currentSection && currentSection->trackingAlgorithm)
+    { // The section is tracked again from its beginning
+        delete currentSection->trackingAlgorithm;
+        currentSection->trackingAlgorithm = nullptr;
+    }
+    currentSection = nullptr;
+    nextSection = false;
+
     int64_t lastProcessedTimestamp;
     if (!get_last_processed_timestamp(lastProcessedTimestamp))
         return; // Nothing processed -> nothing to be erased
@@ -641,3 +867,175 @@ void TrackedObject::erase_trajectory_to_comply()
 
     trajectory.erase(trajectory.find(section->second.initialTimestamp), trajectory.end()); // Clear all the trajectory from Current section initial timestamp till the end
 }
+
+void TrackedObject::set_tracking_stride(unsigned int stride)
+{
+    revision = new_revision();
+    trackingStride = stride > 0 ? stride : 1;
+    strideFallback = false;
+    reliableFrames = 0;
+}
+
+unsigned int TrackedObject::get_tracking_stride() const
+{
+    return trackingStride;
+}
+
+void TrackedObject::set_tracking_parameters(TrackingParameters const &parameters)
+{
+    revision = new_revision();
+    trackingParameters = parameters;
+
+    if (currentSection && currentSection->trackingAlgorithm)
+    {
+        delete currentSection->trackingAlgorithm;
+        currentSection->trackingAlgorithm = nullptr;
+    }
+    currentSection = nullptr;
+    nextSection = false;
+    endedBySceneCut = false; // The whole trajectory is tracked again
+    allProcessed = false;
+
+    for (auto &section: trajectorySections)
+        section.second.backwardTrajectory.clear(); // Tracked with the former parameters
+
+    trajectory.clear(); // Also notifies readers of the backward trajectories
+}
+
+TrackingParameters TrackedObject::get_tracking_parameters() const
+{
+    return trackingParameters;
+}
+
+bool TrackedObject::erase_degraded()
+{
+    auto degradedEntry = std::find_if(trajectory.begin(), trajectory.end(),
+                                      [](Trajectory::value_type const &entry) { return entry.second.degraded; });
+    if (degradedEntry == trajectory.end())
+        return false;
+
+    revision = new_revision();
+
+    qDebug() << "Frames tracked with reduced quality are tracked again";
+
+    if (currentSection && currentSection->trackingAlgorithm)
+    { // The trackingAlgorithm needs to go from the section's beginning again
+        delete currentSection->trackingAlgorithm;
+        currentSection->trackingAlgorithm = nullptr;
+    }
+    currentSection = nullptr;
+    nextSection = false;
+    clear_scene_cut();
+    allProcessed = false;
+
+    // The section's tracking algorithm needs to go from its beginning to have the correct data
+    auto section = --(trajectorySections.upper_bound(degradedEntry->first));
+    trajectory.erase(trajectory.find(section->first), trajectory.end());
+
+    return true;
+}
+
+bool TrackedObject::is_stride_frame(VideoFrame const *frame) const
+{
+    if (trackingStride <= 1 || strideFallback)
+        return true;
+
+    unsigned long frameNumber = frame->get_frame_number();
+    if (frameNumber - lastTrackedFrameNumber >= trackingStride)
+        return true;
+
+    // The last frame of the object and of the section must be tracked so no positions stay uninterpolated
+    if (endTimestampSet && frame->get_timestamp() >= endTimestamp)
+        return true;
+
+    if (nextSection && trajectorySections.at(nextSectionTimestamp).initialFrameNumber <= frameNumber + 1)
+        return true;
+
+    return false;
+}
+
+void TrackedObject::interpolate_skipped(Selection const &position, unsigned long frameNumber)
+{
+    double step = frameNumber - lastTrackedFrameNumber;
+
+    for (auto iterator = trajectory.upper_bound(lastTrackedTimestamp);
+         iterator != trajectory.end() && iterator->second.frameNumber < frameNumber; iterator++)
+    {
+        double ratio = (iterator->second.frameNumber - lastTrackedFrameNumber) / step;
+        Selection &skipped = iterator->second.position;
+
+        skipped.x = lastTrackedPosition.x + std::lround((position.x - lastTrackedPosition.x) * ratio);
+        skipped.y = lastTrackedPosition.y + std::lround((position.y - lastTrackedPosition.y) * ratio);
+        skipped.width = lastTrackedPosition.width + std::lround((position.width - lastTrackedPosition.width) * ratio);
+        skipped.height = lastTrackedPosition.height + std::lround((position.height - lastTrackedPosition.height) * ratio);
+        skipped.angle = lastTrackedPosition.angle + (position.angle - lastTrackedPosition.angle) * ratio;
+        trajectory.touch(iterator->first);
+    }
+}
+
+bool TrackedObject::set_backward_trajectory(int64_t sectionTimestamp, std::map<int64_t, TrajectoryEntry> const &entries)
+{
+    revision = new_revision();
+    auto section = trajectorySections.find(sectionTimestamp);
+    if (section == trajectorySections.end())
+        return false;
+
+    std::map<int64_t, TrajectoryEntry> &backwardTrajectory = section->second.backwardTrajectory;
+
+    bool shrunk = !backwardTrajectory.empty() &&
+            (entries.empty() || backwardTrajectory.begin()->first < entries.begin()->first);
+
+    if (section == trajectorySections.begin())
+    { // Frames preceding the Beginning are not part of the computed trajectory; its readers are notified through it
+        backwardTrajectory = entries;
+
+        if (shrunk)
+            trajectory.invalidate();
+        else
+        {
+            for (auto const &entry: entries)
+                trajectory.touch(entry.first);
+        }
+        return true;
+    }
+
+    auto previousSection = section;
+    previousSection--;
+    if (shrunk && trajectory.find(backwardTrajectory.begin()->first) != trajectory.end())
+    { // Frames tracked backward before are not covered anymore; the previous section needs to be tracked again
+        if (currentSection && currentSection->trackingAlgorithm)
+        {
+            delete currentSection->trackingAlgorithm;
+            currentSection->trackingAlgorithm = nullptr;
+        }
+        currentSection = nullptr;
+        nextSection = false;
+        clear_scene_cut();
+        allProcessed = false;
+
+        trajectory.erase(trajectory.find(previousSection->first), trajectory.end());
+    }
+
+    backwardTrajectory = entries;
+
+    // Frames already tracked forward from the previous section are replaced
+    for (auto const &entry: entries)
+    {
+        auto iterator = trajectory.find(entry.first);
+        if (iterator != trajectory.end())
+        {
+            iterator->second = entry.second;
+            trajectory.touch(entry.first);
+        }
+    }
+
+    if (currentSection == &(previousSection->second) && !trajectory.empty() &&
+            backwardTrajectory.find(trajectory.rbegin()->first) != backwardTrajectory.end())
+    { // Forward tracking continues from the replaced frame
+        lastTrackedTimestamp = trajectory.rbegin()->first;
+        lastTrackedFrameNumber = trajectory.rbegin()->second.frameNumber;
+        lastTrackedPosition = trajectory.rbegin()->second.position;
+    }
+
+    return true;
+}
@@ -16,24 +16,49 @@
 #include "tracking_algorithm/observetemplate.h"
 #include "tracking_algorithm/state.h"
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <vector>
 
 #define DEFAULT 0
 
 #define DRAW_PARTICLES_REALLOC 512
 
-TrackingAlgorithm::TrackingAlgorithm(cv::Mat const &initialFrame, Selection const &initialPosition, Selection &centerizedPosition)
+#define VIDEOTRACKING_MIN_PARTICLES 20 // Fewer particles are not used even if the time budget is exceeded
+#define VIDEOTRACKING_TIME_SMOOTHING 0.2 // Weight of the last measurement in the average particle time
+#define VIDEOTRACKING_MIN_FOREGROUND 0.05 // Particles with a smaller portion of foreground in their boxes are pruned
+#define VIDEOTRACKING_FACE_MIN_SKIN 0.2 // Particles are not pre-filtered if the reference has a smaller portion of skin
+#define VIDEOTRACKING_FACE_KEPT 0.1 // Portion of particles nearest to the last position kept regardless of skin color
+#define VIDEOTRACKING_PCA_SHIFT 0.05 // Shift of the training variants relative to the size of the object
+#define VIDEOTRACKING_PCA_SCALE 0.05 // Relative scale change of the training variants
+#define VIDEOTRACKING_PCA_BRIGHTNESS 0.1 // Relative brightness change of the training variants
+
+TrackingAlgorithm::TrackingAlgorithm(cv::Mat const &initialFrame, Selection const &initialPosition,
+                                     TrackingParameters const &parameters, Selection &centerizedPosition)
 {
     IplImage *frame = new IplImage(initialFrame);
 
-    resize = cvSize(24, 24);// size
-    pDyn = 100;             // dynamic numer of particles
-    int p = 300;            // number of particles
-    int sx = 5;             // x
-    int sy = 5;             // y
+    resize = cvSize(parameters.featureWidth, parameters.featureHeight);// size
+    pDyn = parameters.dynamicParticles;  // dynamic numer of particles
+    int p = parameters.particles;        // number of particles
+    int sx = parameters.noiseX;          // x
+    int sy = parameters.noiseY;          // y
     int sw = 0;             // width
     int sh = 0;             // height
     int sr = 0;             // rotation
 
+    stdX = sx;
+    stdY = sy;
+    matchError = 0;
+    evaluatedParticles = 0;
+    evaluationTime = 0;
+    motionX = 0;
+    motionY = 0;
+    foregroundMask = nullptr;
+    prunedParticles = 0;
+    faceMode = parameters.faceMode && initialFrame.channels() == 3; // Skin color needs color frames
+    pcaModel = parameters.pcaModel;
+
     CvPoint *particleCenter = NULL;
     if((particleCenter = (CvPoint*)(malloc(DRAW_PARTICLES_REALLOC * sizeof(CvPoint)))) == NULL)
         exit(1);
@@ -64,6 +89,7 @@ TrackingAlgorithm::TrackingAlgorithm(cv::Mat const &initialFrame, Selection cons
     CvRect32f region32f = cvRect32fFromRect( region );
     CvBox32f box = cvBox32fFromRect32f( region32f ); // Centerize
     s = cvParticleState( box.cx, box.cy, box.width, box.height, 0.0 );
+    lastCenter = cvPoint2D32f(box.cx, box.cy);
     cvParticleStateSet( init_particle, 0, s );
     cvParticleInit( static_cast<CvParticle *>(particle), init_particle );
     cvReleaseParticle( &init_particle );
@@ -75,6 +101,26 @@ TrackingAlgorithm::TrackingAlgorithm(cv::Mat const &initialFrame, Selection cons
     cvResize( tmp, reference );
     cvReleaseImage( &tmp );
 
+    if (faceMode)
+    {
+        skinMap.update(initialFrame, cv::Rect(region.x, region.y, region.width, region.height));
+        referenceSkin = skinMap.get_skin_ratio(cv::Rect(region.x, region.y, region.width, region.height));
+    }
+    else
+        referenceSkin = 0;
+
+    resizeReduced = cvSize(resize.width / 2, resize.height / 2);
+    referenceReduced = cvCreateImage( resizeReduced, frame->depth, frame->nChannels );
+    cvResize( reference, referenceReduced, CV_INTER_AREA );
+
+    if (pcaModel)
+        train_pca_model(frame, region);
+
+    timeBudget = 0;
+    particleTime = 0;
+    particleTimeReduced = 0;
+    degraded = false;
+
     centerizedPosition.width = box.width;
     centerizedPosition.height = box.height;
     centerizedPosition.x = box.cx;
@@ -93,14 +139,73 @@ Selection TrackingAlgorithm::track_next_frame(cv::Mat const  &nextImage)
 {
     IplImage *frame = new IplImage(nextImage);
 
+    if (motionX || motionY)
+    { // Shift the particle cloud by the expected motion; the noise then covers only its error
+        CvParticle *p = static_cast<CvParticle *>(particle);
+        for (int i = 0; i < p->num_particles; i++)
+        {
+            cvmSet(p->particles, 0, i, cvmGet(p->particles, 0, i) + motionX);
+            cvmSet(p->particles, 1, i, cvmGet(p->particles, 1, i) + motionY);
+        }
+
+        motionX = 0; // Prior is valid for one frame only
+        motionY = 0;
+    }
+
     cvParticleTransition( static_cast<CvParticle *>(particle) );
 
-    particleEvalDefault( static_cast<CvParticle *>(particle), frame, reference, resize, pDyn);
+    int particles;
+    bool reduced;
+    apply_time_budget(particles, reduced);
+    if (pcaModel)
+        reduced = false; // The PCA model always compares small patches; only the number of particles is limited
+    CvSize featureSize = pcaModel ? cvSize(VIDEOTRACKING_PCA_PATCH, VIDEOTRACKING_PCA_PATCH) :
+                                    (reduced ? resizeReduced : resize);
+    degraded = reduced || particles < pDyn; // Pruned particles do not degrade the quality
+
+    prunedParticles = 0;
+    if (foregroundMask)
+    {
+        int foregroundParticles = prune_by_foreground(particles);
+        if (foregroundParticles >= VIDEOTRACKING_MIN_PARTICLES)
+        { // Otherwise the object probably does not move; evaluate all particles
+            prunedParticles = particles - foregroundParticles;
+            particles = foregroundParticles;
+        }
+        foregroundMask = nullptr; // Mask is valid for one frame only
+    }
+
+    if (faceMode)
+        particles = prefilter_by_skin(frame, particles);
+
+    int64 evalStart = cv::getTickCount();
+    if (pcaModel)
+        evaluate_pca(frame, particles);
+    else
+        particleEvalDefault( static_cast<CvParticle *>(particle), frame, reduced ? referenceReduced : reference,
+                             featureSize, particles);
+    evaluationTime = (cv::getTickCount() - evalStart) * 1000.0 / cv::getTickFrequency();
+    evaluatedParticles = particles;
+    double evalTime = evaluationTime / particles;
+
+    double &averageTime = reduced ? particleTimeReduced : particleTime;
+    averageTime = averageTime > 0 ? averageTime + VIDEOTRACKING_TIME_SMOOTHING * (evalTime - averageTime) : evalTime;
 
     int maxp_id = cvParticleGetMax( static_cast<CvParticle *>(particle) );
     CvParticleState maxs = cvParticleStateGet( static_cast<CvParticle *>(particle), maxp_id );
 
     Selection objectPosition(maxs.x, maxs.y, maxs.width, maxs.height, maxs.angle);
+    lastCenter = cvPoint2D32f(maxs.x, maxs.y);
+
+    if (pcaModel)
+    { // The distance from the subspace has another scale; the thresholds of the matching error are set for the template
+        matchError = get_template_error(frame, objectPosition);
+    }
+    else
+    { // Likelihood is a negative L2 norm; normalize it by the number of compared values
+        double maxLikelihood = cvParticleGetMaxVal( static_cast<CvParticle *>(particle) );
+        matchError = -maxLikelihood / std::sqrt(static_cast<double>(featureSize.width * featureSize.height * reference->nChannels));
+    }
 
     cvParticleNormalize( static_cast<CvParticle *>(particle));
 
@@ -108,3 +213,285 @@ Selection TrackingAlgorithm::track_next_frame(cv::Mat const  &nextImage)
 
     return objectPosition;
 }
+
+void TrackingAlgorithm::set_frame_step(unsigned int step)
+{
+    CvParticle *p = static_cast<CvParticle *>(particle);
+    cvmSet(p->std, 0, 0, stdX * step);
+    cvmSet(p->std, 1, 0, stdY * step);
+}
+
+void TrackingAlgorithm::set_motion_prior(double dx, double dy)
+{
+    motionX = dx;
+    motionY = dy;
+}
+
+void TrackingAlgorithm::set_foreground_mask(ForegroundMask const *mask)
+{
+    foregroundMask = mask;
+}
+
+int TrackingAlgorithm::get_pruned_particles() const
+{
+    return prunedParticles;
+}
+
+int TrackingAlgorithm::prune_by_foreground(int particles)
+{
+    CvParticle *p = static_cast<CvParticle *>(particle);
+
+    int kept = 0;
+    for (int i = 0; i < particles; i++)
+    {
+        CvParticleState s = cvParticleStateGet(p, i);
+        CvRect rect = cvRectFromRect32f(cvRect32fFromBox32f(cvBox32f(s.x, s.y, s.width, s.height, s.angle)));
+        if (foregroundMask->get_foreground_ratio(cv::Rect(rect.x, rect.y, rect.width, rect.height)) < VIDEOTRACKING_MIN_FOREGROUND)
+            continue;
+
+        if (i != kept)
+        { // Swap the particles; weights are computed afterwards and do not need to be swapped
+            for (int row = 0; row < p->num_states; row++)
+            {
+                double value = cvmGet(p->particles, row, kept);
+                cvmSet(p->particles, row, kept, cvmGet(p->particles, row, i));
+                cvmSet(p->particles, row, i, value);
+            }
+        }
+        kept++;
+    }
+
+    return kept;
+}
+
+int TrackingAlgorithm::prefilter_by_skin(IplImage *frame, int particles)
+{
+    int selected = std::max(static_cast<int>(VIDEOTRACKING_FACE_EVALUATED * particles), VIDEOTRACKING_MIN_PARTICLES);
+    if (selected >= particles || referenceSkin < VIDEOTRACKING_FACE_MIN_SKIN)
+        return particles; // Skin color would not tell the particles apart
+
+    CvParticle *p = static_cast<CvParticle *>(particle);
+
+    std::vector<cv::Rect> boxes;
+    boxes.reserve(particles);
+    std::vector<std::pair<double, int>> scores;
+    scores.reserve(particles);
+    cv::Rect region;
+    for (int i = 0; i < particles; i++)
+    {
+        CvParticleState s = cvParticleStateGet(p, i);
+        CvRect rect = cvRectFromRect32f(cvRect32fFromBox32f(cvBox32f(s.x, s.y, s.width, s.height, s.angle)));
+        boxes.emplace_back(rect.x, rect.y, rect.width, rect.height);
+        region = i ? (region | boxes.back()) : boxes.back();
+
+        double dx = s.x - lastCenter.x;
+        double dy = s.y - lastCenter.y;
+        scores.emplace_back(dx * dx + dy * dy, i);
+    }
+
+    // The nearest particles are kept first; they are scored as the best ones
+    int kept = std::min(static_cast<int>(VIDEOTRACKING_FACE_KEPT * particles), selected);
+    std::partial_sort(scores.begin(), scores.begin() + kept, scores.end());
+    for (int i = 0; i < kept; i++)
+        scores[i].first = -1;
+
+    skinMap.update(cv::cvarrToMat(frame), region);
+
+    // The closer the portion of skin to the reference, the better
+    for (int i = kept; i < particles; i++)
+        scores[i].first = std::abs(skinMap.get_skin_ratio(boxes[scores[i].second]) - referenceSkin);
+
+    std::partial_sort(scores.begin() + kept, scores.begin() + selected, scores.end());
+
+    // Reorder the particles; weights are computed afterwards and do not need to be reordered
+    CvMat *states = cvCloneMat(p->particles);
+    for (int i = 0; i < particles; i++)
+    {
+        for (int row = 0; row < p->num_states; row++)
+            cvmSet(p->particles, row, i, cvmGet(states, row, scores[i].second));
+    }
+    cvReleaseMat(&states);
+
+    return selected;
+}
+
+/**
+ * Samples a patch of the given size directly from the box in the frame. Boxes without rotation are
+ * sampled bilinearly, which reads about four pixels per patch pixel regardless of the box size.
+ * @param image Frame data
+ * @param box Box of the object
+ * @param size Size of the patch
+ * @param patch Returned patch
+ * @return False if the box is outside the frame
+ */
+static bool sample_patch(cv::Mat const &image, CvBox32f const &box, cv::Size size, cv::Mat &patch)
+{
+    if (box.angle != 0)
+    { // Rotated boxes are cropped at their full size first
+        CvRect32f rect32f = cvRect32fFromBox32f(box);
+        CvRect rect = cvRectFromRect32f(rect32f);
+        if (rect.width <= 0 || rect.height <= 0)
+            return false;
+
+        IplImage source = image;
+        IplImage *crop = cvCreateImage(cvSize(rect.width, rect.height), source.depth, source.nChannels);
+        cvCropImageROI(&source, crop, rect32f);
+        cv::resize(cv::cvarrToMat(crop), patch, size, 0, 0, cv::INTER_AREA);
+        cvReleaseImage(&crop);
+        return true;
+    }
+
+    cv::Rect rect(cvRound(box.cx - box.width / 2), cvRound(box.cy - box.height / 2), cvRound(box.width), cvRound(box.height));
+    rect &= cv::Rect(0, 0, image.cols, image.rows);
+    if (rect.width <= 0 || rect.height <= 0)
+        return false;
+
+    cv::resize(image(rect), patch, size, 0, 0, cv::INTER_LINEAR);
+    return true;
+}
+
+void TrackingAlgorithm::train_pca_model(IplImage *frame, CvRect region)
+{
+    cv::Mat image = cv::cvarrToMat(frame);
+    cv::Size patchSize(VIDEOTRACKING_PCA_PATCH, VIDEOTRACKING_PCA_PATCH);
+    int dimension = patchSize.area() * frame->nChannels;
+
+    // The initial box and its variants the object is expected to go through
+    std::vector<CvBox32f> boxes;
+    std::vector<double> gains;
+    CvBox32f initial = cvBox32fFromRect32f(cvRect32fFromRect(region));
+    float shiftX = VIDEOTRACKING_PCA_SHIFT * initial.width;
+    float shiftY = VIDEOTRACKING_PCA_SHIFT * initial.height;
+    boxes.push_back(initial);
+    boxes.push_back(cvBox32f(initial.cx - shiftX, initial.cy, initial.width, initial.height, 0));
+    boxes.push_back(cvBox32f(initial.cx + shiftX, initial.cy, initial.width, initial.height, 0));
+    boxes.push_back(cvBox32f(initial.cx, initial.cy - shiftY, initial.width, initial.height, 0));
+    boxes.push_back(cvBox32f(initial.cx, initial.cy + shiftY, initial.width, initial.height, 0));
+    for (double scale: {1 - VIDEOTRACKING_PCA_SCALE, 1 + VIDEOTRACKING_PCA_SCALE})
+        boxes.push_back(cvBox32f(initial.cx, initial.cy, initial.width * scale, initial.height * scale, 0));
+    gains.assign(boxes.size(), 1);
+    boxes.push_back(initial);
+    gains.push_back(1 - VIDEOTRACKING_PCA_BRIGHTNESS);
+    boxes.push_back(initial);
+    gains.push_back(1 + VIDEOTRACKING_PCA_BRIGHTNESS);
+
+    cv::Mat samples(0, dimension, CV_32FC1);
+    cv::Mat patch;
+    for (unsigned int i = 0; i < boxes.size(); i++)
+    {
+        if (!sample_patch(image, boxes[i], patchSize, patch))
+            continue; // Variant outside the frame
+
+        cv::Mat row;
+        patch.reshape(1, 1).convertTo(row, CV_32FC1, gains[i]);
+        samples.push_back(row);
+    }
+
+    if (samples.rows < 2)
+    { // Too few variants inside the frame; patches are compared with the mean only
+        pcaMean = samples.rows ? samples.row(0).clone() : cv::Mat::zeros(1, dimension, CV_32FC1);
+        pcaEigenvectors = cv::Mat::zeros(1, dimension, CV_32FC1);
+        return;
+    }
+
+    int components = std::min(VIDEOTRACKING_PCA_COMPONENTS, samples.rows - 1);
+    cv::PCA pca(samples, cv::Mat(), CV_PCA_DATA_AS_ROW, components);
+    pcaMean = pca.mean;
+    pcaEigenvectors = pca.eigenvectors; // Orthonormal rows
+}
+
+void TrackingAlgorithm::evaluate_pca(IplImage *frame, int particles)
+{
+    CvParticle *p = static_cast<CvParticle *>(particle);
+    cv::Mat image = cv::cvarrToMat(frame);
+    cv::Size patchSize(VIDEOTRACKING_PCA_PATCH, VIDEOTRACKING_PCA_PATCH);
+
+    // Centered patches of all particles are projected at once
+    cv::Mat samples(particles, pcaMean.cols, CV_32FC1);
+    std::vector<bool> valid(particles);
+    cv::Mat patch;
+    for (int i = 0; i < particles; i++)
+    {
+        CvParticleState s = cvParticleStateGet(p, i);
+        cv::Mat row = samples.row(i);
+        valid[i] = sample_patch(image, cvBox32f(s.x, s.y, s.width, s.height, s.angle), patchSize, patch);
+        if (valid[i])
+        {
+            patch.reshape(1, 1).convertTo(row, CV_32FC1);
+            row -= pcaMean;
+        }
+        else
+            row.setTo(0);
+    }
+
+    cv::Mat coefficients; // particles x M
+    cv::gemm(samples, pcaEigenvectors, 1, cv::Mat(), 0, coefficients, cv::GEMM_2_T);
+
+    // The basis is orthonormal, so the reconstruction error is the part of the squared norm
+    // outside the subspace. Likelihood is its negative root; it only orders the particles
+    for (int i = 0; i < particles; i++)
+    {
+        double error = samples.row(i).dot(samples.row(i)) - coefficients.row(i).dot(coefficients.row(i));
+        cvmSet(p->weights, 0, i, valid[i] ? -std::sqrt(std::max(0.0, error)) : -99999.0);
+    }
+
+    for (int i = particles; i < p->num_particles; i++)
+        cvmSet(p->weights, 0, i, -99999.0);
+}
+
+double TrackingAlgorithm::get_template_error(IplImage *frame, Selection const &position) const
+{
+    cv::Mat patch;
+    CvBox32f box = cvBox32f(position.x, position.y, position.width, position.height, position.angle);
+    if (!sample_patch(cv::cvarrToMat(frame), box, cv::Size(resize.width, resize.height), patch))
+        return 255;
+
+    cv::Mat templ = cv::cvarrToMat(reference);
+    return cv::norm(patch, templ, cv::NORM_L2) / std::sqrt(static_cast<double>(templ.total() * templ.channels()));
+}
+
+double TrackingAlgorithm::get_match_error() const
+{
+    return matchError;
+}
+
+int TrackingAlgorithm::get_evaluated_particles() const
+{
+    return evaluatedParticles;
+}
+
+double TrackingAlgorithm::get_evaluation_time() const
+{
+    return evaluationTime;
+}
+
+void TrackingAlgorithm::set_time_budget(double budget)
+{
+    timeBudget = budget;
+}
+
+bool TrackingAlgorithm::is_degraded() const
+{
+    return degraded;
+}
+
+void TrackingAlgorithm::apply_time_budget(int &particles, bool &reduced) const
+{
+    particles = pDyn;
+    reduced = false;
+
+    if (timeBudget <= 0 || particleTime <= 0)
+        return; // No limit or the time of evaluation is not known yet
+
+    if (particleTime * pDyn <= timeBudget)
+        return; // Full quality fits into the budget
+
+    particles = timeBudget / particleTime;
+    if (particles >= VIDEOTRACKING_MIN_PARTICLES)
+        return;
+
+    // Not even the minimal number of particles fits; use the reduced resolution
+    reduced = true;
+    double time = particleTimeReduced > 0 ? particleTimeReduced : particleTime / 2; // Estimate until measured
+    particles = std::max(VIDEOTRACKING_MIN_PARTICLES, std::min(pDyn, static_cast<int>(timeBudget / time)));
+}
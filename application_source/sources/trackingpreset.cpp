@@ -0,0 +1,11 @@
+/**
+ * @file trackingpreset.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "trackingpreset.h"
+
+const unsigned TrackingPreset::FAST = 1;
+const unsigned TrackingPreset::BALANCED = 2;
+const unsigned TrackingPreset::ACCURATE = 3;
@@ -0,0 +1,213 @@
+/**
+ * @file trackingworker.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "trackingworker.h"
+
+#include <QDebug>
+#include <chrono>
+
+#define VIDEOTRACKING_WORKER_IDLE 100 // Waiting time when there is nothing to track; in milliseconds
+
+TrackingWorker::TrackingWorker(std::string const &videoAddr, FFmpegPlayer const &analyzedPlayer,
+                               std::vector<std::shared_ptr<TrackedObject>> const &trackedObjects,
+                               std::recursive_mutex &objectsMutex) :
+    player(videoAddr, analyzedPlayer),
+    frame(analyzedPlayer.get_width(), analyzedPlayer.get_height()),
+    trackedObjects(trackedObjects),
+    objectsMutex(objectsMutex)
+{
+    frameValid = false;
+    stopRequested = false;
+    restartRequested = false;
+    playhead = 0;
+}
+
+TrackingWorker::~TrackingWorker()
+{
+    stop();
+}
+
+void TrackingWorker::start()
+{
+    if (thread.joinable())
+        return; // Already running
+
+    stopRequested = false;
+    restartRequested = false;
+    thread = std::thread(&TrackingWorker::run, this);
+}
+
+void TrackingWorker::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopRequested = true;
+    }
+    stateChanged.notify_one();
+
+    if (thread.joinable())
+        thread.join();
+}
+
+void TrackingWorker::restart()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        restartRequested = true;
+    }
+    stateChanged.notify_one();
+}
+
+void TrackingWorker::set_playhead(int64_t timestamp)
+{
+    playhead = timestamp;
+    stateChanged.notify_one();
+}
+
+bool TrackingWorker::is_running() const
+{
+    return thread.joinable();
+}
+
+void TrackingWorker::set_frame_size(unsigned int width, unsigned int height)
+{
+    assert(!thread.joinable());
+
+    frame.set_size(width, height);
+    frameValid = false;
+}
+
+void TrackingWorker::set_foreground_gating(bool enabled)
+{
+    assert(!thread.joinable());
+
+    frame.set_foreground_gating(enabled);
+}
+
+void TrackingWorker::set_luma_only(bool enabled)
+{
+    assert(!thread.joinable());
+
+    frame.set_luma_only(enabled);
+    frameValid = false;
+}
+
+void TrackingWorker::set_motion_vectors(bool enabled)
+{
+    assert(!thread.joinable());
+
+    player.set_motion_vectors(enabled);
+}
+
+bool TrackingWorker::interrupted() const
+{
+    return stopRequested || restartRequested;
+}
+
+void TrackingWorker::run()
+{
+    qDebug() << "Background tracking started";
+
+    while (!stopRequested)
+    {
+        restartRequested = false;
+
+        std::vector<std::shared_ptr<TrackedObject>> objects;
+        {
+            std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+            objects = trackedObjects; // Objects might be added or removed meanwhile
+        }
+
+        bool tracked = false;
+        for (auto const &object: objects)
+        {
+            if (interrupted())
+                break;
+
+            if (track_ahead(object))
+                tracked = true;
+        }
+
+        if (tracked || interrupted())
+            continue;
+
+        // All objects are tracked far enough; wait until the playhead moves
+        std::unique_lock<std::mutex> lock(stateMutex);
+        stateChanged.wait_for(lock, std::chrono::milliseconds(VIDEOTRACKING_WORKER_IDLE),
+                              [this] { return stopRequested || restartRequested; });
+    }
+
+    qDebug() << "Background tracking stopped";
+}
+
+bool TrackingWorker::track_ahead(std::shared_ptr<TrackedObject> const &object)
+{
+    bool tracked = false;
+
+    for (unsigned int i = 0; i < VIDEOTRACKING_WORKER_CHUNK && !interrupted(); i++)
+    {
+        int64_t lastProcessedTimestamp;
+        bool lastProcessedTimestampSet;
+        int64_t initialTimestamp;
+
+        {
+            std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+            if (object->is_all_processed())
+                return tracked;
+
+            lastProcessedTimestampSet = object->get_last_processed_timestamp(lastProcessedTimestamp);
+            initialTimestamp = object->get_initial_timestamp();
+            frame.set_conversion_region(object->get_search_region(&frame)); // Convert just the surroundings of the object
+        }
+
+        int64_t frontier = lastProcessedTimestampSet ? lastProcessedTimestamp : initialTimestamp;
+        if (player.get_time_position_by_timestamp(frontier) >
+                player.get_time_position_by_timestamp(playhead) + VIDEOTRACKING_LOOKAHEAD_TIME)
+            return tracked; // Tracked far enough ahead of the playhead
+
+        // Decoding does not need the objects; the mutex stays unlocked
+        if (!lastProcessedTimestampSet)
+        { // Nothing processed, begin with the initial frame
+            frameValid = player.get_frame_by_timestamp(&frame, initialTimestamp);
+            if (!frameValid)
+                return tracked;
+        }
+        else
+        {
+            if (!frameValid || frame.get_timestamp() != lastProcessedTimestamp)
+            { // Decoder is not at the last processed frame; seek it
+                frameValid = player.get_frame_by_timestamp(&frame, lastProcessedTimestamp);
+                if (!frameValid)
+                    return tracked;
+            }
+
+            frameValid = player.get_next_frame(&frame);
+            if (!frameValid)
+            { // No more frames => all processed for this object
+                std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+
+                int64_t timestamp;
+                if (object->get_last_processed_timestamp(timestamp) && timestamp == lastProcessedTimestamp)
+                    object->set_all_processed(true);
+
+                return tracked;
+            }
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+
+        int64_t timestamp;
+        bool timestampSet = object->get_last_processed_timestamp(timestamp);
+        if (object->is_all_processed() || timestampSet != lastProcessedTimestampSet ||
+                (timestampSet && timestamp != lastProcessedTimestamp))
+            continue; // The object was changed or tracked by VideoTracker meanwhile; start from its new state
+
+        object->track_next(&frame);
+        tracked = true;
+    }
+
+    return tracked;
+}
@@ -0,0 +1,223 @@
+/**
+ * @file trajectory.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "trajectory.h"
+
+#include <cassert>
+
+namespace
+{
+    bool timestamp_less(std::pair<int64_t, TrajectoryEntry> const &slot, int64_t timestamp)
+    {
+        return slot.first < timestamp;
+    }
+
+    bool timestamp_greater(int64_t timestamp, std::pair<int64_t, TrajectoryEntry> const &slot)
+    {
+        return timestamp < slot.first;
+    }
+}
+
+std::atomic<unsigned long> Trajectory::lastVersion(0);
+
+Trajectory::Trajectory() :
+    firstFrameNumber(0),
+    count(0),
+    resetVersion(new_version())
+{
+}
+
+TrajectoryEntry &Trajectory::set(int64_t timestamp, TrajectoryEntry const &entry)
+{
+    record_change(timestamp);
+
+    if (slots.empty())
+    {
+        firstFrameNumber = entry.frameNumber;
+        slots.push_back(value_type(timestamp, entry));
+        valid.push_back(true);
+        count = 1;
+        return slots.back().second;
+    }
+
+    if (entry.frameNumber < firstFrameNumber)
+    { // Frames tracked backward are added in front; missing frames take the new entry's timestamp
+        size_t shift = firstFrameNumber - entry.frameNumber;
+        slots.insert(slots.begin(), shift, value_type(timestamp, TrajectoryEntry()));
+        valid.insert(valid.begin(), shift, false);
+        firstFrameNumber = entry.frameNumber;
+    }
+
+    size_t index = entry.frameNumber - firstFrameNumber;
+    if (index >= slots.size())
+    { // Missing frames take the timestamp of the preceding entry
+        slots.resize(index + 1, value_type(slots.back().first, TrajectoryEntry()));
+        valid.resize(index + 1, false);
+    }
+
+    if (!valid[index])
+    {
+        valid[index] = true;
+        count++;
+    }
+    slots[index] = value_type(timestamp, entry);
+
+    // Keep the timestamps of following missing frames sorted
+    for (size_t i = index + 1; i < slots.size() && !valid[i] && slots[i].first < timestamp; i++)
+        slots[i].first = timestamp;
+
+    return slots[index].second;
+}
+
+Trajectory::iterator Trajectory::emplace_hint(const_iterator, int64_t timestamp, TrajectoryEntry entry)
+{
+    set(timestamp, entry);
+    return iterator(&slots, &valid, entry.frameNumber - firstFrameNumber);
+}
+
+void Trajectory::erase(const_iterator first, const_iterator last)
+{
+    for (size_t i = first.index; i < last.index; i++)
+    {
+        if (valid[i])
+        {
+            valid[i] = false;
+            count--;
+        }
+    }
+
+    if (first != last) // Readers cannot follow erased entries
+        invalidate();
+
+    // Erased slots must not keep their timestamps; they would be found by a binary search
+    for (size_t i = std::max<size_t>(first.index, 1); i < slots.size() && !valid[i]; i++)
+        slots[i].first = slots[i - 1].first;
+
+    trim();
+}
+
+void Trajectory::clear()
+{
+    slots.clear();
+    valid.clear();
+    firstFrameNumber = 0;
+    count = 0;
+    invalidate();
+}
+
+void Trajectory::touch(int64_t timestamp)
+{
+    record_change(timestamp);
+}
+
+void Trajectory::invalidate()
+{
+    changes.clear();
+    resetVersion = new_version();
+}
+
+unsigned long Trajectory::get_version() const
+{
+    return changes.empty() ? resetVersion : changes.back().first;
+}
+
+bool Trajectory::get_changes(unsigned long version, std::vector<int64_t> &timestamps) const
+{
+    timestamps.clear();
+    if (version < resetVersion || version > get_version()) // Newer versions belong to another trajectory
+        return false;
+
+    auto change = std::upper_bound(changes.begin(), changes.end(), version,
+                                   [](unsigned long version, std::pair<unsigned long, int64_t> const &change)
+                                   { return version < change.first; });
+    for (; change != changes.end(); ++change)
+        timestamps.push_back(change->second);
+
+    std::sort(timestamps.begin(), timestamps.end());
+    timestamps.erase(std::unique(timestamps.begin(), timestamps.end()), timestamps.end());
+    return true;
+}
+
+size_t Trajectory::find_index(int64_t timestamp) const
+{
+    if (slots.empty())
+        return 0;
+
+    int64_t firstTimestamp = slots.front().first;
+    int64_t lastTimestamp = slots.back().first;
+    if (timestamp < firstTimestamp || timestamp > lastTimestamp)
+        return slots.size();
+
+    if (lastTimestamp > firstTimestamp)
+    {
+        size_t guess = static_cast<size_t>((static_cast<double>(timestamp - firstTimestamp) * (slots.size() - 1)) /
+                                           (lastTimestamp - firstTimestamp) + 0.5);
+        if (guess < slots.size() && valid[guess] && slots[guess].first == timestamp)
+            return guess;
+    }
+
+    size_t index = lower_index(timestamp);
+    if (index < slots.size() && slots[index].first == timestamp)
+        return index;
+
+    return slots.size();
+}
+
+size_t Trajectory::lower_index(int64_t timestamp) const
+{ // A missing frame holds the timestamp of a preceding valid slot which is therefore found first
+    size_t index = std::lower_bound(slots.begin(), slots.end(), timestamp, timestamp_less) - slots.begin();
+    assert(index == slots.size() || valid[index]);
+    return index;
+}
+
+size_t Trajectory::upper_index(int64_t timestamp) const
+{
+    size_t index = std::upper_bound(slots.begin(), slots.end(), timestamp, timestamp_greater) - slots.begin();
+    assert(index == slots.size() || valid[index]);
+    return index;
+}
+
+void Trajectory::record_change(int64_t timestamp)
+{
+    if (changes.size() >= VIDEOTRACKING_TRAJECTORY_CHANGES_MAX)
+    { // The older half is dropped; readers that have not seen it read the whole trajectory
+        auto kept = changes.begin() + changes.size() / 2;
+        resetVersion = (kept - 1)->first;
+        changes.erase(changes.begin(), kept);
+    }
+
+    changes.push_back(std::make_pair(new_version(), timestamp));
+}
+
+unsigned long Trajectory::new_version()
+{
+    return ++lastVersion;
+}
+
+void Trajectory::trim()
+{
+    if (count == 0)
+    {
+        clear();
+        return;
+    }
+
+    size_t last = slots.size();
+    while (!valid[last - 1])
+        last--;
+    slots.resize(last);
+    valid.resize(last);
+
+    size_t first = 0;
+    while (!valid[first])
+        first++;
+    if (first)
+    {
+        slots.erase(slots.begin(), slots.begin() + first);
+        valid.erase(valid.begin(), valid.begin() + first);
+        firstFrameNumber += first;
+    }
+}
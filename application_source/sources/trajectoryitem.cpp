@@ -11,11 +11,12 @@
 
 TrajectoryItem::TrajectoryItem(int64_t timestamp, unsigned long timePosition, unsigned long totalTime,
                                unsigned long frameNumber, unsigned long frameCount, Selection position,
-                               QWidget *parent, bool displayTime) :
+                               QWidget *parent, bool displayTime, bool interpolated, bool lowConfidence) :
     QWidget(parent),
     timestamp(timestamp),
     timePosition(timePosition),
-    frameNumber(frameNumber)
+    frameNumber(frameNumber),
+    interpolated(interpolated)
 {
 
     QWidget *title = new QWidget(this);
@@ -54,6 +55,10 @@ TrajectoryItem::TrajectoryItem(int64_t timestamp, unsigned long timePosition, un
     valuesString.append(QString::number(position.width));
     valuesString.append("<FONT COLOR='#909090'> " + tr("h") + ":</FONT>");
     valuesString.append(QString::number(position.height));
+    if (interpolated)
+        valuesString.append("<FONT COLOR='#909090'> (" + tr("interpolated") + ")</FONT>");
+    if (lowConfidence)
+        valuesString.append("<FONT COLOR='#D04040'> (" + tr("low confidence") + ")</FONT>");
 
     QLabel *values = new QLabel(valuesString, this);
     values->setContentsMargins(0,0,0,5);
@@ -97,6 +102,11 @@ int64_t TrajectoryItem::get_timestamp() const
     return timestamp;
 }
 
+bool TrajectoryItem::is_interpolated() const
+{
+    return interpolated;
+}
+
 void TrajectoryItem::display_time()
 {
     timeLabel->display_time(timePosition, false);
@@ -7,23 +7,52 @@
 #include "videoframe.h"
 
 #include <QDebug>
+#include <cmath>
+#include <algorithm>
+
+extern "C"{
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
 
 VideoFrame::VideoFrame():
     scalingMethod(VIDEOTRACKING_DEFAULT_SCALING_METHOD)
 {
     matFrame = nullptr;
     avFrame = nullptr;
+    foregroundMask = nullptr;
+    lumaOnly = false;
+    decodeOnly = false;
+    yuvOnly = false;
+    displayPool = nullptr;
+    displayWidth = 0;
+    displayHeight = 0;
+    decodedFrame = nullptr;
+    matPending = false;
     width = 0;
     height = 0;
+    sourceWidth = 0;
+    sourceHeight = 0;
 }
 
 VideoFrame::VideoFrame(unsigned int width, unsigned int height):
     scalingMethod(VIDEOTRACKING_DEFAULT_SCALING_METHOD),
     width(width),
-    height(height)
+    height(height),
+    sourceWidth(width),
+    sourceHeight(height)
 {
     matFrame = nullptr;
     avFrame = nullptr;
+    foregroundMask = nullptr;
+    lumaOnly = false;
+    decodeOnly = false;
+    yuvOnly = false;
+    displayPool = nullptr;
+    displayWidth = 0;
+    displayHeight = 0;
+    decodedFrame = nullptr;
+    matPending = false;
 }
 
 //VideoFrame::VideoFrame(cv::Mat const &newFrame, int64_t timestamp, unsigned long timePosition):
@@ -32,14 +61,26 @@ VideoFrame::VideoFrame(VideoFrame const &obj):
     scalingMethod(VIDEOTRACKING_DEFAULT_SCALING_METHOD)
 {
     avFrame = nullptr;
+    foregroundMask = nullptr; // A copy is not read continuously
+    lumaOnly = obj.lumaOnly;
+    decodeOnly = false;
+    yuvOnly = false; // avFrame is not copied
+    displayPool = nullptr; // A copy is not displayed
+    displayWidth = 0;
+    displayHeight = 0;
+    decodedFrame = nullptr;
+    matPending = false;
 
     if (obj.matFrame)
-        matFrame = new cv::Mat(*(obj.matFrame));
+        matFrame = new cv::Mat(*(obj.get_mat_frame()));
     else
         matFrame = nullptr;
 
     height = obj.height;
     width = obj.width;
+    sourceWidth = obj.sourceWidth;
+    sourceHeight = obj.sourceHeight;
+    motionVectors = obj.motionVectors;
     timestamp = obj.timestamp;
     timePosition = obj.timePosition;
 }
@@ -57,19 +98,282 @@ VideoFrame::~VideoFrame()
         av_frame_free(&avFrame);
         avFrame = nullptr;
     }
+    av_frame_free(&decodedFrame);
+    delete foregroundMask;
 }
 
 bool VideoFrame::set_frame(AVFrame const *newFrame)
 {
+    if (yuvOnly)
+    {
+        if (!avFrame && !allocate_av_frame())
+            return false;
+
+        sourceWidth = newFrame->width;
+        sourceHeight = newFrame->height;
+
+        if (newFrame->format == outputFormat && newFrame->width == static_cast<int>(width) &&
+                newFrame->height == static_cast<int>(height))
+        { // Planes are only copied
+            av_image_copy(avFrame->data, avFrame->linesize, const_cast<uint8_t const **>(newFrame->data), newFrame->linesize,
+                          static_cast<enum AVPixelFormat>(outputFormat), width, height);
+            return true;
+        }
+
+        SwsContext *conversionContext = sws_getContext(newFrame->width, newFrame->height, (enum PixelFormat)newFrame->format,
+                                                       width, height, (enum PixelFormat)outputFormat,
+                                                       scalingMethod, NULL, NULL, NULL);
+        if (!conversionContext)
+        {
+            qDebug() << "Error - set_frame: sws_getContext";
+            return false;
+        }
+
+        sws_scale(conversionContext, newFrame->data, newFrame->linesize, 0, newFrame->height, avFrame->data, avFrame->linesize);
+        sws_freeContext(conversionContext);
+        return true;
+    }
+
     if (!matFrame) // matFrame is nullptr and was not allocated yet
     {
         if (!width || !height) // equals one of them zero?
             return false;
         else
-            matFrame = new cv::Mat(height, width, CV_8UC3); // CV_8UC3->3 channels of unsigned 8-bit int
+            matFrame = new cv::Mat(height, width, lumaOnly ? CV_8UC1 : CV_8UC3); // CV_8UC3->3 channels of unsigned 8-bit int
     }
 
-    return AVFrame2Mat(newFrame, matFrame);
+    sourceWidth = newFrame->width;
+    sourceHeight = newFrame->height;
+
+    if (foregroundMask)
+        set_foreground_luma(newFrame); // The decoder reuses the plane
+
+    if (decodeOnly)
+    { // matFrame keeps the former picture
+        motionVectors.clear();
+        return true;
+    }
+
+    if (displayPool && !AVFrame2Display(newFrame))
+        return false;
+
+    motionVectors.clear();
+    AVFrameSideData *sideData = av_frame_get_side_data(const_cast<AVFrame *>(newFrame), AV_FRAME_DATA_MOTION_VECTORS);
+    if (sideData)
+    {
+        AVMotionVector const *vectors = reinterpret_cast<AVMotionVector const *>(sideData->data);
+        motionVectors.assign(vectors, vectors + sideData->size / sizeof(AVMotionVector));
+    }
+
+    if (displayPool)
+    { // Displayed frames are converted to cv::Mat only when it is read, e.g. for tracking
+        if (!decodedFrame && !(decodedFrame = av_frame_alloc()))
+            return false;
+
+        av_frame_unref(decodedFrame);
+        if (av_frame_ref(decodedFrame, newFrame) < 0)
+        {
+            qDebug() << "Error - set_frame: av_frame_ref";
+            return false;
+        }
+
+        matPending = true;
+        return true;
+    }
+
+    matPending = false;
+    if (decodedFrame)
+        av_frame_unref(decodedFrame);
+    return convert_frame(newFrame);
+}
+
+bool VideoFrame::convert_frame(AVFrame const *src) const
+{
+    cv::Rect region = conversionRegion & cv::Rect(0, 0, src->width, src->height);
+    if (lumaOnly && has_luma_plane(src->format))
+        return Luma2Mat(src, matFrame, conversionRegion.area() > 0 ? region : cv::Rect());
+
+    if (conversionRegion.area() > 0 && !(foregroundMask && foregroundLuma.empty()) &&
+            region.area() < VIDEOTRACKING_REGION_CONVERSION_MAX * src->width * src->height)
+        return AVFrame2MatRegion(src, matFrame, region);
+
+    return AVFrame2Mat(src, matFrame);
+}
+
+void VideoFrame::set_display_size(ImagePool *pool, unsigned int displayWidth, unsigned int displayHeight)
+{
+    displayPool = pool;
+    this->displayWidth = displayWidth;
+    this->displayHeight = displayHeight;
+    // The current display image keeps the former size; it is still painted scaled
+}
+
+QImage VideoFrame::get_display_image() const
+{
+    return displayImage;
+}
+
+void VideoFrame::set_conversion_region(cv::Rect const &region)
+{
+    conversionRegion = region;
+}
+
+void VideoFrame::set_decode_only(bool enabled)
+{
+    decodeOnly = enabled;
+}
+
+void VideoFrame::set_foreground_gating(bool enabled)
+{
+    if (enabled && !foregroundMask)
+        foregroundMask = new ForegroundMask();
+    else if (!enabled)
+    {
+        delete foregroundMask;
+        foregroundMask = nullptr;
+        foregroundLuma.release();
+    }
+}
+
+void VideoFrame::set_luma_only(bool enabled)
+{
+    if (enabled == lumaOnly)
+        return;
+
+    lumaOnly = enabled;
+
+    // Number of channels changed; it will be allocated when needed
+    delete matFrame;
+    matFrame = nullptr;
+    matPending = false;
+
+    if (foregroundMask)
+        foregroundMask->reset();
+}
+
+bool VideoFrame::is_luma_only() const
+{
+    return lumaOnly;
+}
+
+void VideoFrame::set_yuv_only(bool enabled)
+{
+    yuvOnly = enabled;
+
+    // Only one of the representations is kept
+    delete matFrame;
+    matFrame = nullptr;
+    matPending = false;
+}
+
+bool VideoFrame::get_planes(std::vector<cv::Mat> &planes)
+{
+    if (!yuvOnly || !avFrame)
+        return false;
+
+    AVPixFmtDescriptor const *descriptor = av_pix_fmt_desc_get(static_cast<enum AVPixelFormat>(outputFormat));
+
+    planes.clear();
+    for (int i = 0; i < 3; i++)
+    {
+        bool chroma = (i == 1 || i == 2);
+        int planeWidth = chroma ? -((-static_cast<int>(width)) >> descriptor->log2_chroma_w) : width; // Rounded up
+        int planeHeight = chroma ? -((-static_cast<int>(height)) >> descriptor->log2_chroma_h) : height;
+        planes.push_back(cv::Mat(planeHeight, planeWidth, CV_8UC1, avFrame->data[i], avFrame->linesize[i]));
+    }
+
+    return true;
+}
+
+ForegroundMask const *VideoFrame::get_foreground_mask() const
+{
+    if (!foregroundMask)
+        return nullptr;
+
+    if (foregroundMask->get_frame_number() != frameNumber)
+    {
+        if (!foregroundLuma.empty()) // Complete even if only a region of matFrame is converted
+            foregroundMask->update(foregroundLuma, cv::Size(width, height), frameNumber);
+        else
+        {
+            cv::Mat const *frame = get_mat_frame();
+            if (!frame)
+                return nullptr;
+
+            foregroundMask->update(*frame, cv::Size(width, height), frameNumber);
+        }
+    }
+
+    return foregroundMask->is_valid() ? foregroundMask : nullptr;
+}
+
+bool VideoFrame::set_scaled_frame(VideoFrame const &source)
+{
+    if (!source.matFrame)
+        return false;
+
+    if (!matFrame) // matFrame is nullptr and was not allocated yet
+    {
+        if (!width || !height) // equals one of them zero?
+            return false;
+        else
+            matFrame = new cv::Mat(height, width, lumaOnly ? CV_8UC1 : CV_8UC3); // CV_8UC3->3 channels of unsigned 8-bit int
+    }
+
+    if (source.matPending)
+    { // The decoded picture is scaled directly; the source frame is not converted at the full resolution
+        if (!AVFrame2Mat(source.decodedFrame, matFrame))
+            return false;
+    }
+    else if (matFrame->channels() == source.matFrame->channels())
+        cv::resize(*source.matFrame, *matFrame, matFrame->size(), 0, 0, cv::INTER_AREA);
+    else
+    { // Scaled down first so as less pixels are converted
+        cv::Mat scaled;
+        cv::resize(*source.matFrame, scaled, matFrame->size(), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(scaled, *matFrame, CV_BGR2GRAY);
+    }
+
+    foregroundLuma.release(); // The whole frame was scaled; the mask is computed from it
+
+    timestamp = source.timestamp;
+    timePosition = source.timePosition;
+    frameNumber = source.frameNumber;
+    sourceWidth = source.sourceWidth;
+    sourceHeight = source.sourceHeight;
+    motionVectors = source.motionVectors;
+
+    return true;
+}
+
+bool VideoFrame::get_motion(cv::Rect const &region, double &dx, double &dy) const
+{
+    std::vector<int> motionX;
+    std::vector<int> motionY;
+
+    for (AVMotionVector const &vector: motionVectors)
+    {
+        if (!region.contains(cv::Point(vector.dst_x, vector.dst_y)))
+            continue;
+
+        // The block comes from src in a past (source < 0) or future reference frame
+        int sign = vector.source < 0 ? 1 : -1;
+        motionX.push_back(sign * (vector.dst_x - vector.src_x));
+        motionY.push_back(sign * (vector.dst_y - vector.src_y));
+    }
+
+    if (motionX.empty())
+        return false;
+
+    // Median is not affected by blocks of the background
+    auto middleX = motionX.begin() + motionX.size() / 2;
+    auto middleY = motionY.begin() + motionY.size() / 2;
+    std::nth_element(motionX.begin(), middleX, motionX.end());
+    std::nth_element(motionY.begin(), middleY, motionY.end());
+    dx = *middleX;
+    dy = *middleY;
+
+    return true;
 }
 
 
@@ -99,6 +403,48 @@ unsigned int VideoFrame::get_height() const
     return height;
 }
 
+unsigned int VideoFrame::get_source_width() const
+{
+    return sourceWidth;
+}
+
+unsigned int VideoFrame::get_source_height() const
+{
+    return sourceHeight;
+}
+
+Selection VideoFrame::to_frame_coordinates(Selection const &position) const
+{
+    if (!sourceWidth || !sourceHeight || (width == sourceWidth && height == sourceHeight))
+        return position;
+
+    double scaleX = static_cast<double>(width) / sourceWidth;
+    double scaleY = static_cast<double>(height) / sourceHeight;
+
+    Selection result = position;
+    result.x = std::lround(position.x * scaleX);
+    result.y = std::lround(position.y * scaleY);
+    result.width = std::lround(position.width * scaleX);
+    result.height = std::lround(position.height * scaleY);
+    return result;
+}
+
+Selection VideoFrame::to_source_coordinates(Selection const &position) const
+{
+    if (!width || !height || (width == sourceWidth && height == sourceHeight))
+        return position;
+
+    double scaleX = static_cast<double>(sourceWidth) / width;
+    double scaleY = static_cast<double>(sourceHeight) / height;
+
+    Selection result = position;
+    result.x = std::lround(position.x * scaleX);
+    result.y = std::lround(position.y * scaleY);
+    result.width = std::lround(position.width * scaleX);
+    result.height = std::lround(position.height * scaleY);
+    return result;
+}
+
 void VideoFrame::set_size(unsigned int newWidth, unsigned int newHeight)
 {
     width = newWidth;
@@ -110,6 +456,11 @@ void VideoFrame::set_size(unsigned int newWidth, unsigned int newHeight)
         delete matFrame;
         matFrame = nullptr;
     }
+    matPending = false;
+
+    foregroundLuma.release();
+    if (foregroundMask)
+        foregroundMask->reset();
 }
 
 void VideoFrame::set_timestamp(int64_t newTimestamp)
@@ -130,45 +481,34 @@ void VideoFrame::set_frame_number(unsigned long newFrameNumber)
 AVFrame const *VideoFrame::get_av_frame()
 //AVFrame *VideoFrame::get_av_frame()
 {
-    if (matFrame == nullptr) // There is not a valid frame that could be converted to AVFrame
-        return nullptr;
-
-    if (!avFrame)
-    {
-        avFrame = av_frame_alloc();
-        if (avFrame == nullptr)
-        {
-            qDebug() << "Not allocated";
-            exit(1);
-        }
-        int numBytes = avpicture_get_size((enum PixelFormat)outputFormat, width, height);
-        if (numBytes < 0)
-        {
-            qDebug() << "Error: avpicture_get_size()";
-            exit(1);
-        }
+    if (yuvOnly)
+    { // The picture is already in avFrame
+        if (avFrame)
+            avFrame->pts = timestamp;
+        return avFrame;
+    }
 
-        uint8_t *buffer = (uint8_t *)av_malloc(numBytes * sizeof(uint8_t));
-        if (buffer == nullptr)
-        {
-            qDebug() << "Not allocated";
-            exit(1);
-        }
+    cv::Mat const *frame = get_mat_frame();
+    if (frame == nullptr) // There is not a valid frame that could be converted to AVFrame
+        return nullptr;
 
-        if (avpicture_fill((AVPicture *)avFrame, buffer, (enum PixelFormat)outputFormat, width, height) < 0)
-        {
-            qDebug() << "Error: avpicture_fill()";
-            exit(1);
-        }
-    }
+    if (!avFrame && !allocate_av_frame())
+        return nullptr;
 
-    Mat2AVFrame(*matFrame, avFrame, outputFormat);
+    Mat2AVFrame(*frame, avFrame, outputFormat);
     avFrame->pts = timestamp;
     return avFrame;
 }
 
 cv::Mat const *VideoFrame::get_mat_frame() const
 {
+    if (matPending && matFrame)
+    { // Converted when it is read for the first time
+        matPending = false;
+        if (!convert_frame(decodedFrame))
+            qDebug() << "Error - get_mat_frame: convert_frame";
+    }
+
     return matFrame;
 }
 
@@ -183,8 +523,10 @@ bool VideoFrame::AVFrame2Mat(AVFrame const *src, cv::Mat *dstMat) const
 
     dst->data[0] = (uint8_t *)dstMat->data; //dstMat->data is used as a buffer
 
+    enum PixelFormat dstFormat = dstMat->channels() == 1 ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_BGR24;
+
     // note: avpicture_fill does not perform a deep copy
-    if (avpicture_fill((AVPicture *)dst, dst->data[0], AV_PIX_FMT_BGR24, src->width, src->height) < 0)
+    if (avpicture_fill((AVPicture *)dst, dst->data[0], dstFormat, dstMat->cols, dstMat->rows) < 0)
     {
         qDebug() << "Error - AVFrame2Mat: avpicture_fill";
         av_frame_free(&dst);
@@ -193,8 +535,9 @@ bool VideoFrame::AVFrame2Mat(AVFrame const *src, cv::Mat *dstMat) const
     }
 
     SwsContext *conversionContext = nullptr; // Context is needed for sws_scale
+    // The frame is scaled to the size of dstMat; tracking frames may be smaller than the video
     conversionContext = sws_getContext(src->width, src->height, (enum PixelFormat)src->format,
-                                 src->width, src->height, AV_PIX_FMT_BGR24,
+                                 dstMat->cols, dstMat->rows, dstFormat,
                                  scalingMethod, NULL, NULL, NULL); // xal
 
 
@@ -210,6 +553,200 @@ bool VideoFrame::AVFrame2Mat(AVFrame const *src, cv::Mat *dstMat) const
     return true;
 }
 
+bool VideoFrame::AVFrame2Display(AVFrame const *src)
+{
+    displayImage = QImage(); // The previous picture stays in the images that are still displayed
+
+    if (!displayWidth || !displayHeight)
+        return false;
+
+    cv::Mat buffer;
+    QImage image = displayPool->get(displayWidth, displayHeight, buffer);
+
+    SwsContext *conversionContext = sws_getContext(src->width, src->height, (enum PixelFormat)src->format,
+                                                   displayWidth, displayHeight, AV_PIX_FMT_BGRA,
+                                                   scalingMethod, NULL, NULL, NULL);
+    if (!conversionContext)
+    {
+        qDebug() << "Error - AVFrame2Display: sws_getContext";
+        return false;
+    }
+
+    uint8_t *dstData[4] = {buffer.data, nullptr, nullptr, nullptr};
+    int dstLinesize[4] = {static_cast<int>(buffer.step), 0, 0, 0};
+    sws_scale(conversionContext, src->data, src->linesize, 0, src->height, dstData, dstLinesize);
+    sws_freeContext(conversionContext);
+
+    displayImage = image;
+    return true;
+}
+
+bool VideoFrame::AVFrame2MatRegion(AVFrame const *src, cv::Mat *dstMat, cv::Rect region) const
+{
+    assert(src != nullptr);
+
+    AVPixFmtDescriptor const *descriptor = av_pix_fmt_desc_get((enum AVPixelFormat)src->format);
+    if (!descriptor || (descriptor->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL)))
+        return AVFrame2Mat(src, dstMat); // Planes cannot be simply cropped
+
+    // Chroma planes are subsampled; the region needs to cover whole chroma samples
+    int alignX = 1 << descriptor->log2_chroma_w;
+    int alignY = 1 << descriptor->log2_chroma_h;
+    int right = std::min(src->width, (region.x + region.width + alignX - 1) / alignX * alignX);
+    int bottom = std::min(src->height, (region.y + region.height + alignY - 1) / alignY * alignY);
+    region.x -= region.x % alignX;
+    region.y -= region.y % alignY;
+    region.width = right - region.x;
+    region.height = bottom - region.y;
+    if (region.width <= 0 || region.height <= 0)
+        return true; // Nothing to convert
+
+    // The same as av_picture_crop() does, but for any pixel format
+    int pixelSteps[4];
+    av_image_fill_max_pixsteps(pixelSteps, NULL, descriptor);
+
+    uint8_t const *srcData[4] = {nullptr, nullptr, nullptr, nullptr};
+    int srcLinesize[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 4 && src->data[i]; i++)
+    {
+        bool chroma = (i == 1 || i == 2);
+        int x = chroma ? (region.x >> descriptor->log2_chroma_w) : region.x;
+        int y = chroma ? (region.y >> descriptor->log2_chroma_h) : region.y;
+
+        srcData[i] = src->data[i] + y * src->linesize[i] + x * pixelSteps[i];
+        srcLinesize[i] = src->linesize[i];
+    }
+
+    // dstMat may be scaled
+    double scaleX = static_cast<double>(dstMat->cols) / src->width;
+    double scaleY = static_cast<double>(dstMat->rows) / src->height;
+    cv::Rect dstRegion(std::lround(region.x * scaleX), std::lround(region.y * scaleY),
+                       std::lround(region.width * scaleX), std::lround(region.height * scaleY));
+    dstRegion &= cv::Rect(0, 0, dstMat->cols, dstMat->rows);
+    if (dstRegion.width <= 0 || dstRegion.height <= 0)
+        return true; // Nothing to convert
+
+    uint8_t *dstData[4] = {dstMat->data + dstRegion.y * dstMat->step + dstRegion.x * dstMat->elemSize(), nullptr, nullptr, nullptr};
+    int dstLinesize[4] = {static_cast<int>(dstMat->step), 0, 0, 0};
+
+    SwsContext *conversionContext = sws_getContext(region.width, region.height, (enum PixelFormat)src->format,
+                                                   dstRegion.width, dstRegion.height,
+                                                   dstMat->channels() == 1 ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_BGR24,
+                                                   scalingMethod, NULL, NULL, NULL);
+    if (!conversionContext)
+    {
+        qDebug() << "Error - AVFrame2MatRegion: sws_getContext";
+        return false;
+    }
+
+    sws_scale(conversionContext, srcData, srcLinesize, 0, region.height, dstData, dstLinesize);
+
+    sws_freeContext(conversionContext);
+    conversionContext = nullptr;
+
+    return true;
+}
+
+bool VideoFrame::allocate_av_frame()
+{
+    avFrame = av_frame_alloc();
+    if (avFrame == nullptr)
+    {
+        qDebug() << "Not allocated";
+        exit(1);
+    }
+    int numBytes = avpicture_get_size((enum PixelFormat)outputFormat, width, height);
+    if (numBytes < 0)
+    {
+        qDebug() << "Error: avpicture_get_size()";
+        exit(1);
+    }
+
+    uint8_t *buffer = (uint8_t *)av_malloc(numBytes * sizeof(uint8_t));
+    if (buffer == nullptr)
+    {
+        qDebug() << "Not allocated";
+        exit(1);
+    }
+
+    if (avpicture_fill((AVPicture *)avFrame, buffer, (enum PixelFormat)outputFormat, width, height) < 0)
+    {
+        qDebug() << "Error: avpicture_fill()";
+        exit(1);
+    }
+
+    avFrame->width = width;
+    avFrame->height = height;
+    avFrame->format = outputFormat;
+
+    return true;
+}
+
+bool VideoFrame::Luma2Mat(AVFrame const *src, cv::Mat *dstMat, cv::Rect region) const
+{
+    assert(src != nullptr);
+
+    // The decoder reuses its buffers; the plane is only wrapped and its rows are copied
+    cv::Mat plane(src->height, src->width, CV_8UC1, src->data[0], src->linesize[0]);
+    if (region.area() == 0)
+        region = cv::Rect(0, 0, src->width, src->height);
+
+    if (dstMat->cols == src->width && dstMat->rows == src->height)
+    {
+        plane(region).copyTo((*dstMat)(region));
+        return true;
+    }
+
+    // dstMat may be scaled
+    double scaleX = static_cast<double>(dstMat->cols) / src->width;
+    double scaleY = static_cast<double>(dstMat->rows) / src->height;
+    cv::Rect dstRegion(std::lround(region.x * scaleX), std::lround(region.y * scaleY),
+                       std::lround(region.width * scaleX), std::lround(region.height * scaleY));
+    dstRegion &= cv::Rect(0, 0, dstMat->cols, dstMat->rows);
+    if (dstRegion.width <= 0 || dstRegion.height <= 0)
+        return true; // Nothing to convert
+
+    cv::Mat dstPlane = (*dstMat)(dstRegion);
+    cv::resize(plane(region), dstPlane, dstRegion.size(), 0, 0, cv::INTER_AREA);
+
+    return true;
+}
+
+void VideoFrame::set_foreground_luma(AVFrame const *src)
+{
+    if (!has_luma_plane(src->format))
+    { // The whole frame is converted instead
+        foregroundLuma.release();
+        return;
+    }
+
+    cv::Mat plane(src->height, src->width, CV_8UC1, src->data[0], src->linesize[0]);
+    cv::resize(plane, foregroundLuma, ForegroundMask::get_downsampled_size(cv::Size(width, height)), 0, 0, cv::INTER_AREA);
+}
+
+bool VideoFrame::has_luma_plane(int format) const
+{
+    switch (format)
+    {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUV422P:
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUV444P:
+    case AV_PIX_FMT_YUVJ444P:
+    case AV_PIX_FMT_YUV440P:
+    case AV_PIX_FMT_YUVJ440P:
+    case AV_PIX_FMT_YUV411P:
+    case AV_PIX_FMT_YUV410P:
+    case AV_PIX_FMT_NV12:
+    case AV_PIX_FMT_NV21:
+    case AV_PIX_FMT_GRAY8:
+        return true;
+    default:
+        return false; // Packed, paletted or high bit depth formats are converted by swscale
+    }
+}
+
 bool VideoFrame::Mat2AVFrame(cv::Mat const &src, AVFrame *dstAVFrame, const int dstFormat) const
 {
     //assert(src != nullptr);
@@ -225,10 +762,11 @@ bool VideoFrame::Mat2AVFrame(cv::Mat const &src, AVFrame *dstAVFrame, const int
         return false;
     }
 
-    avpicture_fill((AVPicture *)srcAV, (uint8_t *)src.data, AV_PIX_FMT_BGR24, width, height);
+    enum PixelFormat srcFormat = src.channels() == 1 ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_BGR24;
+    avpicture_fill((AVPicture *)srcAV, (uint8_t *)src.data, srcFormat, width, height);
 
     // all frames have same width, height, format ...
-    SwsContext *conversionContext = sws_getContext(width, height, PIX_FMT_BGR24,
+    SwsContext *conversionContext = sws_getContext(width, height, srcFormat,
                                  width, height, (enum PixelFormat)dstFormat,
                                  scalingMethod, NULL, NULL, NULL); // xal
 
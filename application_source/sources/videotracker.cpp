@@ -10,6 +10,10 @@
 #include "videotracker.h"
 #include "avwriter.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
 using namespace cv;
 
 VideoTracker::VideoTracker()
@@ -17,11 +21,29 @@ VideoTracker::VideoTracker()
     player = nullptr;
     currentFrame = nullptr;
     tempFrame = nullptr;
+    trackingFrame = nullptr;
+    worker = nullptr;
+    trackingBudget = 0;
+    currentFrameDecoded = true;
+    objectsRevision = 0;
+    outputMarkedFrames = 0;
+    outputMarkTime = 0;
+    outputMarkTiles = 0;
+    previewWidth = 0;
+    previewHeight = 0;
     qDebug() << "new videoTracker";
 }
 
 VideoTracker::VideoTracker(std::string const &videoAddr, QProgressDialog const *progressDialog)
 {
+    trackingBudget = 0;
+    currentFrameDecoded = true;
+    objectsRevision = 0;
+    outputMarkedFrames = 0;
+    outputMarkTime = 0;
+    outputMarkTiles = 0;
+    previewWidth = 0;
+    previewHeight = 0;
     load_video(videoAddr, progressDialog);
 }
 
@@ -29,9 +51,173 @@ void VideoTracker::load_video(std::string const &videoAddr, QProgressDialog cons
 {
     av_register_all();
 
+    videoAddress = videoAddr;
     player = new FFmpegPlayer(videoAddr, progressDialog);
     currentFrame = new VideoFrame(player->get_width(), player->get_height()); // stores currently read frame
     tempFrame = new VideoFrame(player->get_width(), player->get_height()); // stores temporary frame when tracking
+    trackingFrame = new VideoFrame(player->get_width(), player->get_height());
+    set_display_size(player->get_width(), player->get_height());
+
+    // Background tracking has its own decoder
+    worker = new TrackingWorker(videoAddr, *player, trackedObjects, objectsMutex);
+}
+
+void VideoTracker::start_background_tracking()
+{
+    if (worker)
+        worker->start();
+}
+
+void VideoTracker::stop_background_tracking()
+{
+    if (worker)
+        worker->stop();
+}
+
+void VideoTracker::set_tracking_budget(double budget)
+{
+    trackingBudget = budget;
+}
+
+void VideoTracker::set_foreground_gating(bool enabled)
+{
+    // The worker's frame is changed while it is not running
+    bool workerRunning = worker->is_running();
+    worker->stop();
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+
+        currentFrame->set_foreground_gating(enabled);
+        tempFrame->set_foreground_gating(enabled);
+        trackingFrame->set_foreground_gating(enabled);
+        worker->set_foreground_gating(enabled);
+    }
+
+    if (workerRunning)
+        worker->start();
+}
+
+void VideoTracker::set_motion_prior(bool enabled)
+{
+    // The worker's player is changed while it is not running
+    bool workerRunning = worker->is_running();
+    worker->stop();
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+
+        player->set_motion_vectors(enabled);
+        worker->set_motion_vectors(enabled);
+    }
+
+    if (workerRunning)
+        worker->start();
+}
+
+void VideoTracker::set_luma_tracking(bool enabled)
+{
+    if (enabled == tempFrame->is_luma_only())
+        return;
+
+    // The worker's frame is changed while it is not running
+    bool workerRunning = worker->is_running();
+    worker->stop();
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+
+        tempFrame->set_luma_only(enabled);
+        trackingFrame->set_luma_only(enabled);
+        worker->set_luma_only(enabled);
+
+        // References of the sections being tracked have the former number of channels
+        for (auto object: trackedObjects)
+            object->erase_trajectory_to_comply();
+    }
+
+    if (workerRunning)
+        worker->start();
+}
+
+bool VideoTracker::set_preview_size(unsigned int width, unsigned int height)
+{
+    unsigned int videoWidth = player->get_width();
+    unsigned int videoHeight = player->get_height();
+
+    unsigned int newWidth = 0;
+    unsigned int newHeight = 0;
+    if (width && height)
+    { // Keep the aspect ratio; frames are not scaled up
+        double scale = std::min(1.0, std::min(static_cast<double>(width) / videoWidth, static_cast<double>(height) / videoHeight));
+        newWidth = std::max(1L, std::lround(videoWidth * scale));
+        newHeight = std::max(1L, std::lround(videoHeight * scale));
+    }
+
+    if (newWidth == previewWidth && newHeight == previewHeight)
+        return false;
+
+    previewWidth = newWidth;
+    previewHeight = newHeight;
+    frameCache.clear(); // Cached frames have the former size
+    imagePool.clear();
+    if (previewWidth)
+        set_display_size(previewWidth, previewHeight);
+    else
+        set_display_size(videoWidth, videoHeight);
+    return true;
+}
+
+void VideoTracker::set_display_size(unsigned int width, unsigned int height)
+{
+    currentFrame->set_display_size(&imagePool, width, height);
+
+    // Buffers of cached frames are kept in the pool as well, so frames removed from the cache return them for reuse
+    size_t imageBytes = static_cast<size_t>(width) * height * 4;
+    imagePool.set_max_buffers(VIDEOTRACKING_IMAGE_POOL_SIZE + frameCache.get_budget() / imageBytes);
+}
+
+unsigned int VideoTracker::get_width() const
+{
+    return player->get_width();
+}
+
+unsigned int VideoTracker::get_height() const
+{
+    return player->get_height();
+}
+
+void VideoTracker::set_tracking_resolution(unsigned int maxHeight)
+{
+    unsigned int width = player->get_width();
+    unsigned int height = player->get_height();
+    if (maxHeight && maxHeight < height)
+    { // Keep the aspect ratio; sws_scale needs an even width
+        width = (width * maxHeight / height) & ~1u;
+        height = maxHeight;
+    }
+
+    if (width == tempFrame->get_width() && height == tempFrame->get_height())
+        return;
+
+    // The worker's frame is resized while it is not running
+    bool workerRunning = worker->is_running();
+    worker->stop();
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+
+        tempFrame->set_size(width, height);
+        trackingFrame->set_size(width, height);
+        worker->set_frame_size(width, height);
+
+        // Tracking algorithms of the sections being tracked work with the former resolution
+        for (auto object: trackedObjects)
+            object->erase_trajectory_to_comply();
+    }
+
+    if (workerRunning)
+        worker->start();
 }
 
 VideoTracker::~VideoTracker()
@@ -44,12 +230,18 @@ VideoTracker::~VideoTracker()
         object = nullptr;
     }
 */
+    delete worker; // Stops the background thread first
+    worker = nullptr;
+
     delete currentFrame;
     currentFrame = nullptr;
 
     delete tempFrame;
     tempFrame = nullptr;
 
+    delete trackingFrame;
+    trackingFrame = nullptr;
+
     delete player;
     player = nullptr;
 }
@@ -61,6 +253,7 @@ void VideoTracker::seek_first_packet()
     {
         qDebug() << "ERROR-create_output: seek_first_packet";
     }
+    currentFrameDecoded = true; // The player is positioned explicitly
 
 }
 
@@ -70,19 +263,30 @@ int VideoTracker::add_object(Characteristics const &objectAppearance, std::strin
 {
     qDebug() << "Initialize tracking";
 
-    auto newObject = std::make_shared<TrackedObject>(objectAppearance, objectName, initialTimestamp, initialPosition,
-                                                     initialTimePosition, initialFrameNumber, endTimestampSet,
-                                                     endTimestamp, endTimePosition, endFrameNumber);
-
-    trackedObjects.push_back(newObject);
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
 
     if (!player->get_frame_by_timestamp(currentFrame, initialTimestamp))
     {
         qDebug()<< "Tracker: Cannot read this frame.";
         return -1;
     }
+    currentFrameDecoded = true;
+
+    auto newObject = std::make_shared<TrackedObject>(objectAppearance, objectName, initialTimestamp, initialPosition,
+                                                     initialTimePosition, initialFrameNumber, endTimestampSet,
+                                                     endTimestamp, endTimePosition, endFrameNumber);
+
+    return add_object(newObject, currentFrame);
+}
+
+int VideoTracker::add_object(std::shared_ptr<TrackedObject> const &newObject, VideoFrame const *initialFrame)
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
 
-    newObject->track_next(currentFrame);
+    trackedObjects.push_back(newObject);
+
+    newObject->track_next(get_tracking_frame(initialFrame));
+    worker->restart();
     qDebug() << "Initialized";
 
     return trackedObjects.size() - 1;
@@ -90,53 +294,40 @@ int VideoTracker::add_object(Characteristics const &objectAppearance, std::strin
 
 bool VideoTracker::get_frame_by_time(QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal, int64_t time, QProgressDialog *progressDialog)
 {
+    if (get_cached_frame(player->get_timestamp_by_time(time), imgFrame, originalImgFrame, includeOriginal))
+        return true;
 
     if (!player->get_frame_by_time(currentFrame, time))
         return false;
 
-    Mat result = currentFrame->get_mat_frame()->clone(); // Simple assignment would do only a shallow copy, clone() is needed
-    if (!track_frame(currentFrame, result, progressDialog))
-        return false;
-
-    if (includeOriginal)
-        originalImgFrame = Mat2QImage(*currentFrame->get_mat_frame());
-
-    imgFrame = Mat2QImage(result);
-    return true;
+    currentFrameDecoded = true;
+    return render_current_frame(imgFrame, originalImgFrame, includeOriginal, progressDialog);
 }
 
 bool VideoTracker::get_frame_by_timestamp(QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal, int64_t timestamp, QProgressDialog *progressDialog)
 {
+    if (get_cached_frame(timestamp, imgFrame, originalImgFrame, includeOriginal))
+        return true;
 
     if (!player->get_frame_by_timestamp(currentFrame, timestamp))
         return false;
 
-    Mat result = currentFrame->get_mat_frame()->clone(); // Simple assignment would do only a shallow copy, clone() is needed
-    if (!track_frame(currentFrame, result, progressDialog))
-        return false;
-
-    if (includeOriginal)
-        originalImgFrame = Mat2QImage(*currentFrame->get_mat_frame());
-
-    imgFrame = Mat2QImage(result);
-    return true;
+    currentFrameDecoded = true;
+    return render_current_frame(imgFrame, originalImgFrame, includeOriginal, progressDialog);
 }
 
 bool VideoTracker::get_frame_by_number(QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal, unsigned long frameNumber, QProgressDialog *progressDialog)
 {
+    int64_t timestamp;
+    if (player->get_timestamp_by_number(frameNumber, timestamp) &&
+            get_cached_frame(timestamp, imgFrame, originalImgFrame, includeOriginal))
+        return true;
 
     if (!player->get_frame_by_number(currentFrame, frameNumber))
         return false;
 
-    Mat result = currentFrame->get_mat_frame()->clone(); // Simple assignment would do only a shallow copy, clone() is needed
-    if (!track_frame(currentFrame, result, progressDialog))
-        return false;
-
-    if (includeOriginal)
-        originalImgFrame = Mat2QImage(*currentFrame->get_mat_frame());
-
-    imgFrame = Mat2QImage(result);
-    return true;
+    currentFrameDecoded = true;
+    return render_current_frame(imgFrame, originalImgFrame, includeOriginal, progressDialog);
 }
 
 bool VideoTracker::get_next_frame(QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal, QProgressDialog *progressDialog)
@@ -149,41 +340,32 @@ bool VideoTracker::get_next_frame(QImage &imgFrame, QImage &originalImgFrame, bo
     // track_frame does not need to jump since the currentlly read frame is the
     // following to the previously tracked.
 
+    if (!decode_current_frame())
+        return false;
+
     int64_t previousTimestamp = currentFrame->get_timestamp();
 
     if (!player->get_next_frame(currentFrame))
         return false;
 
-    Mat result = currentFrame->get_mat_frame()->clone(); // Simple assignment would do only a shallow copy, clone() is needed
-    if (!track_frame(currentFrame, result, progressDialog, true, previousTimestamp))
-        return false;
-
-    if (includeOriginal)
-        originalImgFrame = Mat2QImage(*currentFrame->get_mat_frame());
-
-    imgFrame = Mat2QImage(result);
-    return true;
+    return render_current_frame(imgFrame, originalImgFrame, includeOriginal, progressDialog, true, previousTimestamp);
 }
 
 bool VideoTracker::get_previous_frame(QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal, QProgressDialog *progressDialog)
 {
-    if (!player->get_previous_frame(currentFrame))
+    if (!decode_current_frame())
         return false;
 
-    Mat result = currentFrame->get_mat_frame()->clone(); // Simple assignment would do only a shallow copy, clone() is needed
-    if (!track_frame(currentFrame, result, progressDialog))
+    if (!player->get_previous_frame(currentFrame))
         return false;
 
-    if (includeOriginal)
-        originalImgFrame = Mat2QImage(*currentFrame->get_mat_frame());
-
-    imgFrame = Mat2QImage(result);
-    return true;
+    return render_current_frame(imgFrame, originalImgFrame, includeOriginal, progressDialog);
 }
 
 bool VideoTracker::get_first_frame(QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal, QProgressDialog *progressDialog)
 {
     player->seek_first_packet();
+    currentFrameDecoded = true; // The player is positioned before the first frame
 
     return get_next_frame(imgFrame, originalImgFrame, includeOriginal, progressDialog);
 }
@@ -191,111 +373,258 @@ bool VideoTracker::get_first_frame(QImage &imgFrame, QImage &originalImgFrame, b
 
 bool VideoTracker::get_current_frame(QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal)
 {
+    if (get_cached_frame(currentFrame->get_timestamp(), imgFrame, originalImgFrame, includeOriginal))
+        return true;
+
+    if (!decode_current_frame())
+        return false;
+
+    return render_current_frame(imgFrame, originalImgFrame, includeOriginal, nullptr);
+}
+
+bool VideoTracker::get_cached_frame(int64_t timestamp, QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal)
+{
+    unsigned long timePosition;
+    unsigned long frameNumber;
+    remove_changed_frames();
+    if (!frameCache.find(timestamp, get_render_revision(), includeOriginal, imgFrame, originalImgFrame,
+                         timePosition, frameNumber))
+        return false;
+
+    // The frame is not decoded; it is read when the player moves from it
+    if (timestamp != currentFrame->get_timestamp())
+        currentFrameDecoded = false;
+
+    currentFrame->set_timestamp(timestamp);
+    currentFrame->set_time_position(timePosition);
+    currentFrame->set_frame_number(frameNumber);
+    return true;
+}
+
+bool VideoTracker::decode_current_frame()
+{
+    if (currentFrameDecoded)
+        return true;
+
+    if (!player->get_frame_by_timestamp(currentFrame, currentFrame->get_timestamp()))
+        return false;
+
+    currentFrameDecoded = true;
+    return true;
+}
+
+bool VideoTracker::render_current_frame(QImage &imgFrame, QImage &originalImgFrame, bool includeOriginal,
+                                        QProgressDialog *progressDialog, bool previousTimestampSet, int64_t previousTimestamp)
+{
+    // Objects may change in the background while rendering; such a frame is not cached
+    unsigned long revision = get_render_revision();
 
-    Mat result = currentFrame->get_mat_frame()->clone(); // Simple assignment would do only a shallow copy, clone() is needed
-    if (!track_frame(currentFrame, result, nullptr))
+    if (!track_frame(currentFrame, progressDialog, previousTimestampSet, previousTimestamp))
         return false;
 
+    // The display image is converted straight from the decoded picture at the preview size
+    QImage displayImage = currentFrame->get_display_image();
+    if (displayImage.isNull())
+    {
+        qDebug() << "ERROR-render_current_frame(): No display image";
+        return false;
+    }
+
     if (includeOriginal)
-        originalImgFrame = Mat2QImage(*currentFrame->get_mat_frame());
+        originalImgFrame = displayImage; // The display image is never drawn into; it can be shared
+
+    if (compositor.empty())
+        imgFrame = displayImage;
+    else
+    {
+        Mat display(displayImage.height(), displayImage.width(), CV_8UC4, const_cast<uchar *>(displayImage.constBits()),
+                    displayImage.bytesPerLine());
+        Mat result;
+        imgFrame = imagePool.get(display.cols, display.rows, result);
+        display.copyTo(result);
+
+        // All marks are drawn at once so overlapping objects are not drawn over each other
+        compositor.compose(result, static_cast<double>(display.cols) / player->get_width());
+    }
+
+    if (revision == get_render_revision())
+        frameCache.insert(currentFrame->get_timestamp(), revision, imgFrame, includeOriginal ? originalImgFrame : QImage(),
+                          currentFrame->get_time_position(), currentFrame->get_frame_number());
 
-    imgFrame = Mat2QImage(result);
     return true;
 }
 
-bool VideoTracker::track_frame(VideoFrame const *originalFrame, cv::Mat &result, QProgressDialog *progressDialog, bool previousTimestampSet,
+unsigned long VideoTracker::get_render_revision() const
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+
+    unsigned long revision = objectsRevision;
+    for (auto object: trackedObjects)
+        revision = std::max(revision, object->get_revision());
+
+    return revision;
+}
+
+void VideoTracker::remove_changed_frames()
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+
+    std::vector<int64_t> timestamps;
+    for (auto object: trackedObjects)
+    {
+        Trajectory const &trajectory = object->get_trajectory();
+        unsigned long &version = cachedVersions[object.get()];
+
+        if (!trajectory.get_changes(version, timestamps))
+            frameCache.clear(); // Too many changes to follow
+        else
+        {
+            for (int64_t timestamp: timestamps)
+                frameCache.remove(timestamp);
+        }
+
+        version = trajectory.get_version();
+    }
+}
+
+bool VideoTracker::track_frame(VideoFrame const *originalFrame, QProgressDialog *progressDialog, bool previousTimestampSet,
                                int64_t previousTimestamp)
 {
     int64_t currentTimestamp = originalFrame->get_timestamp();
 
+    // Objects are tracked ahead of this frame in the background. If the background tracking is
+    // overtaken, the missing frames are tracked here. Tracked objects stay locked except while
+    // events are processed.
+    worker->set_playhead(currentTimestamp);
+    std::unique_lock<std::recursive_mutex> lock(objectsMutex);
+
+    compositor.clear();
     if (!trackedObjects.empty())
     {
         Selection trackedPosition;
+        auto objects = trackedObjects; // Objects might be added or removed while events are processed
         //for (TrackedObject *object: trackedObjects)
-        for (auto object: trackedObjects)
+        for (auto object: objects)
         {
-            if ((object->get_initial_timestamp() > currentTimestamp) ||
-                    ((object->is_end_timestamp_set() && object->get_end_timestamp() < currentTimestamp)))
+            if ((object->get_first_timestamp() > currentTimestamp) ||
+                    ((object->is_end_timestamp_set() && object->get_end_timestamp() < currentTimestamp)) ||
+                    object->is_after_scene_cut(currentTimestamp))
                 continue; // In this case current timestamp is out of the range of this tracked object
 
-            int64_t lastProcessedTimestamp;
-            bool lastProcessedTimestampSet = object->get_last_processed_timestamp(lastProcessedTimestamp); // If the frame was already processed but the whole video is not yet processed
-            if (object->is_all_processed() || (lastProcessedTimestampSet && currentTimestamp <= lastProcessedTimestamp))
+            bool reached = true; // The object has a position in this frame
+            bool changed = true; // The object was changed while events were processed; its state is read again
+            while (changed)
             {
-                if (!object->get_position(currentTimestamp, trackedPosition))// Position is already known as this frame has already been processed.
+                changed = false;
+
+                int64_t lastProcessedTimestamp;
+                bool lastProcessedTimestampSet = object->get_last_processed_timestamp(lastProcessedTimestamp); // If the frame was already processed but the whole video is not yet processed
+                if (object->is_all_processed() || (lastProcessedTimestampSet && currentTimestamp <= lastProcessedTimestamp) ||
+                        currentTimestamp < object->get_initial_timestamp()) // Frames preceding the Beginning were tracked backward
                 {
-                    return false;
+                    if (!object->get_position(currentTimestamp, trackedPosition))// Position is already known as this frame has already been processed.
+                    {
+                        return false;
+                    }
                 }
-            }
-            else if (previousTimestampSet && (lastProcessedTimestamp == previousTimestamp)) // Is used only with function "get_next_frame"; instead of seeking frame it uses the current one as it is the right one when obtained by get_next_frame(); that's much faster
-                trackedPosition = object->track_next(originalFrame);
-            /**else if (!object->is_initialized())
-            {
-                qDebug() << "ERROR - VideoTracker: tracking frame when trackedObject not initialized";
-                return false;
-            }*/
-            else
-            {
-                if (progressDialog)
+                else if (previousTimestampSet && (lastProcessedTimestamp == previousTimestamp)) // Is used only with function "get_next_frame"; instead of seeking frame it uses the current one as it is the right one when obtained by get_next_frame(); that's much faster
                 {
-                    progressDialog->show();
+                    trackedPosition = object->track_next(get_tracking_frame(originalFrame), trackingBudget / trackedObjects.size()); // During playback, the budget is shared by all objects
                 }
-                if (lastProcessedTimestampSet)
+                /**else if (!object->is_initialized())
                 {
-                    // Set to the last processed position. This frame won't be used, but allows to use "get_next_frame".
-                    // It might be possible to skip this frame and find right the desired (next) one.
-                    // However, it would be more complicated and won't make it much faster.
-                    if (!player->get_frame_by_timestamp(tempFrame, lastProcessedTimestamp))
-                        return false;
-
-                    if (!player->get_next_frame(tempFrame)) // No more frames => all processed for this object
-                    {
-                        object->set_all_processed(true);
-                        continue;
-                    }
-                }
+                    qDebug() << "ERROR - VideoTracker: tracking frame when trackedObject not initialized";
+                    return false;
+                }*/
                 else
-                { // So far no frame is processed, therefore lastProcessedTimestamp is not set
-                    if (!player->get_frame_by_timestamp(tempFrame, object->get_initial_timestamp()))
-                        return false;
-                }
-
-                while (true)
                 {
-                    qApp->processEvents(); // Keeps progress bar active
-                    trackedPosition = object->track_next(tempFrame);
+                    if (progressDialog)
+                    {
+                        progressDialog->show();
+                    }
+                    // The frames are only tracked; convert just the surroundings of the object
+                    tempFrame->set_conversion_region(object->get_search_region(tempFrame));
 
-                    if (tempFrame->get_timestamp() >= currentTimestamp)
-                        break;
+                    if (lastProcessedTimestampSet)
+                    {
+                        // Set to the last processed position. This frame won't be used, but allows to use "get_next_frame".
+                        // It might be possible to skip this frame and find right the desired (next) one.
+                        // However, it would be more complicated and won't make it much faster.
+                        if (!player->get_frame_by_timestamp(tempFrame, lastProcessedTimestamp))
+                            return false;
+
+                        if (!player->get_next_frame(tempFrame)) // No more frames => all processed for this object
+                        {
+                            object->set_all_processed(true);
+                            reached = false;
+                            break;
+                        }
+                    }
+                    else
+                    { // So far no frame is processed, therefore lastProcessedTimestamp is not set
+                        if (!player->get_frame_by_timestamp(tempFrame, object->get_initial_timestamp()))
+                            return false;
+                    }
 
-                    if (progressDialog)
+                    while (true)
                     {
-                        if (progressDialog->wasCanceled()) // User cancelled the progress dialog
-                            throw UserCanceledException();
+                        trackedPosition = object->track_next(tempFrame);
+
+                        if (tempFrame->get_timestamp() >= currentTimestamp || object->is_all_processed())
+                            break;
+
+                        // Events may stop or restart the background tracking, which waits for the lock; it is
+                        // released while they are processed
+                        int64_t trackedTimestamp = tempFrame->get_timestamp();
+                        lock.unlock();
+                        qApp->processEvents(); // Keeps progress bar active
+                        lock.lock();
+
+                        if (progressDialog)
+                        {
+                            if (progressDialog->wasCanceled()) // User cancelled the progress dialog
+                                throw UserCanceledException();
+                        }
+
+                        if (object->is_all_processed() || !object->get_last_processed_timestamp(lastProcessedTimestamp) ||
+                                lastProcessedTimestamp != trackedTimestamp)
+                        { // Tracked in the background or edited meanwhile
+                            changed = true;
+                            break;
+                        }
+
+                        tempFrame->set_conversion_region(object->get_search_region(tempFrame));
+                        if (!player->get_next_frame(tempFrame))
+                            return false; // Could not reach desired frame
                     }
 
-                    qApp->processEvents(); // Keeps progress bar active
-                    if (!player->get_next_frame(tempFrame))
-                        return false; // Could not reach desired frame
-                }
+                    if (changed)
+                        continue;
 
-                //while (object->get_last_processed_timestamp() < currentTimestamp);
+                    //while (object->get_last_processed_timestamp() < currentTimestamp);
 
-                assert(currentTimestamp == tempFrame->get_timestamp());
+                    if (object->is_after_scene_cut(currentTimestamp))
+                        break; // Tracking ended at a scene cut before the desired frame
 
+                    assert(currentTimestamp == tempFrame->get_timestamp());
 
-                if (progressDialog)
-                {
-                    if (progressDialog->wasCanceled()) // User cancelled the progress dialog
-                        throw UserCanceledException();
+
+                    if (progressDialog)
+                    {
+                        if (progressDialog->wasCanceled()) // User cancelled the progress dialog
+                            throw UserCanceledException();
+                    }
                 }
             }
 
-            if (!object->draw_mark(result, *originalFrame->get_mat_frame(), currentTimestamp))
-                return false;
+            if (!reached || object->is_after_scene_cut(currentTimestamp))
+                continue; // No more frames, or tracking ended at a scene cut before or in this frame
+
+            compositor.add(*object, currentTimestamp); // Objects without a position in this frame are not drawn
 
         }
         //progressDialog->reset();
+
         return true;
     }
 
@@ -304,18 +633,29 @@ bool VideoTracker::track_frame(VideoFrame const *originalFrame, cv::Mat &result,
 
 bool VideoTracker::track_object(unsigned int objectID, QProgressDialog *progressDialog)
 {
-    auto object = trackedObjects[objectID];
-    if (object->is_all_processed())
-    {
-        return true; // This object is processed throughout all its range
-    }
-    else
+    // Tracked objects stay locked except while events are processed
+    std::unique_lock<std::recursive_mutex> lock(objectsMutex);
+    auto object = trackedObjects[objectID]; // Kept even if the object is removed while events are processed
+
+    if (object->erase_degraded()) // Frames tracked with reduced quality during playback are tracked again
+        worker->restart();
+
+    bool changed = true; // The object was changed while events were processed; its state is read again
+    while (changed)
     {
+        changed = false;
+
+        if (object->is_all_processed())
+            return true; // This object is processed throughout all its range
+
         int64_t endTimestamp = object->get_end_timestamp();
 
         int64_t lastProcessedTimestamp;
         bool lastProcessedTimestampSet = object->get_last_processed_timestamp(lastProcessedTimestamp); // If the frame was already processed but the whole video is not yet processed
 
+        // The frames are only tracked; convert just the surroundings of the object
+        tempFrame->set_conversion_region(object->get_search_region(tempFrame));
+
         if (lastProcessedTimestampSet)
         {
             // Set to the last processed position. This frame won't be used, but allows to use "get_next_frame".
@@ -344,21 +684,34 @@ bool VideoTracker::track_object(unsigned int objectID, QProgressDialog *progress
 
         while (true)
         {
-            qApp->processEvents(); // Keeps progress bar active
             object->track_next(tempFrame); // Also sets object->allProcessed
 
-            if (object->is_end_timestamp_set() && (tempFrame->get_timestamp() >= endTimestamp))
+            if ((object->is_end_timestamp_set() && (tempFrame->get_timestamp() >= endTimestamp)) || object->is_all_processed())
                 break;
 
+            // Events may stop or restart the background tracking, which waits for the lock; it is
+            // released while they are processed
+            int64_t trackedTimestamp = tempFrame->get_timestamp();
+            lock.unlock();
+            qApp->processEvents(); // Keeps progress bar active
+            lock.lock();
+
             if (progressDialog->wasCanceled()) // User canceled the progress dialog
             {
                 // reads last tracked frame; is used for knowing where aborted
                 player->get_current_frame(currentFrame);
+                currentFrameDecoded = true;
                 throw UserCanceledException();
             }
 
-            qApp->processEvents(); // Keeps progress bar active
+            if (object->is_all_processed() || !object->get_last_processed_timestamp(lastProcessedTimestamp) ||
+                    lastProcessedTimestamp != trackedTimestamp)
+            { // Tracked in the background or edited meanwhile
+                changed = true;
+                break;
+            }
 
+            tempFrame->set_conversion_region(object->get_search_region(tempFrame));
             if (!player->get_next_frame(tempFrame))
             {
                 if (object->is_end_timestamp_set())
@@ -373,6 +726,279 @@ bool VideoTracker::track_object(unsigned int objectID, QProgressDialog *progress
     return true;
 }
 
+bool VideoTracker::track_object_backward(unsigned int objectID, int64_t sectionTimestamp, QProgressDialog *progressDialog)
+{
+    // Tracked objects stay locked except while events are processed
+    std::unique_lock<std::recursive_mutex> lock(objectsMutex);
+    auto object = trackedObjects[objectID]; // Kept even if the object is removed while events are processed
+
+    auto const &sections = object->get_trajectory_sections();
+    auto section = sections.find(sectionTimestamp);
+    if (section == sections.end())
+        return false;
+
+    bool fromBeginning = (section == sections.begin());
+    unsigned long stopFrameNumber = 0; // Frames with a lower number are not tracked
+    if (!fromBeginning)
+    { // Meet the forward tracking of the previous section in the middle
+        auto previousSection = section;
+        previousSection--;
+        stopFrameNumber = (previousSection->second.initialFrameNumber + section->second.initialFrameNumber) / 2 + 1;
+    }
+
+    tempFrame->set_conversion_region(cv::Rect()); // Positions in the buffered frames are not known in advance
+    if (!player->get_frame_by_timestamp(tempFrame, sectionTimestamp))
+        return false;
+
+    Selection centerizedPosition;
+    TrackingAlgorithm trackingAlgorithm(*(tempFrame->get_mat_frame()), tempFrame->to_frame_coordinates(section->second.initialPosition),
+                                        object->get_tracking_parameters(), centerizedPosition);
+
+    // Each GOP is decoded forward once into the buffer and then tracked from its end
+    std::vector<std::unique_ptr<VideoFrame>> frames;
+    std::vector<VideoFrame *> buffer;
+    for (unsigned int i = 0; i < VIDEOTRACKING_BACKWARD_BUFFER; i++)
+    {
+        frames.emplace_back(new VideoFrame(tempFrame->get_width(), tempFrame->get_height()));
+        frames.back()->set_luma_only(tempFrame->is_luma_only());
+        buffer.push_back(frames.back().get());
+    }
+
+    std::map<int64_t, TrajectoryEntry> backwardTrajectory;
+    int64_t timestamp = sectionTimestamp;
+    bool finished = false;
+    while (!finished)
+    {
+        unsigned int count;
+        if (!player->read_frames_backward(timestamp, buffer, count))
+            return false;
+
+        if (!count)
+            break; // Beginning of the video
+
+        for (int i = count - 1; i >= 0; i--)
+        {
+            VideoFrame const *frame = buffer[i];
+            if (frame->get_frame_number() < stopFrameNumber)
+            {
+                finished = true;
+                break;
+            }
+
+            Selection position = frame->to_source_coordinates(trackingAlgorithm.track_next_frame(*(frame->get_mat_frame())));
+            if (fromBeginning && trackingAlgorithm.get_match_error() > VIDEOTRACKING_BACKWARD_MAX_ERROR)
+            { // The object is not in the frame anymore
+                finished = true;
+                break;
+            }
+
+            TrajectoryEntry &entry = backwardTrajectory[frame->get_timestamp()];
+            entry = TrajectoryEntry(position, frame->get_time_position(), frame->get_frame_number());
+            entry.set_telemetry(trackingAlgorithm);
+
+            lock.unlock();
+            qApp->processEvents(); // Keeps progress bar active
+            lock.lock();
+
+            if (!object->get_trajectory_sections().count(sectionTimestamp))
+                return false; // The section was removed meanwhile
+
+            if (progressDialog->wasCanceled()) // User canceled the progress dialog
+            {
+                object->set_backward_trajectory(sectionTimestamp, backwardTrajectory);
+                worker->restart(); // Work done in the background might be invalid now
+                throw UserCanceledException();
+            }
+        }
+
+        timestamp = buffer[0]->get_timestamp();
+    }
+
+    object->set_backward_trajectory(sectionTimestamp, backwardTrajectory);
+    worker->restart(); // Work done in the background might be invalid now
+    return true;
+}
+
+int VideoTracker::detect_objects(ObjectDetector &detector, unsigned int interval, Characteristics const &appearance,
+                                 std::string const &namePrefix, QProgressDialog *progressDialog)
+{
+    struct DetectedObject
+    {
+        unsigned int id;
+        Selection position; // Position at the last detection
+        unsigned int misses; // Detections in a row the object was not found in
+        int64_t missTimestamp; // The first frame it was missed at
+        unsigned long missTimePosition;
+        unsigned long missFrameNumber;
+    };
+    std::vector<DetectedObject> detectedObjects; // Objects that have not ended yet
+    int created = 0;
+
+    // Detection has its own decoder; new objects are initialized from its frames
+    FFmpegPlayer detectionPlayer(videoAddress, *player);
+    VideoFrame frame(detectionPlayer.get_width(), detectionPlayer.get_height());
+    std::set<int64_t> const &keyframes = detectionPlayer.get_keyframe_timestamps();
+    auto keyframe = keyframes.begin();
+
+    progressDialog->setMaximum(detectionPlayer.get_frame_count());
+    progressDialog->show();
+
+    bool frameValid = interval ? (detectionPlayer.seek_first_packet() && detectionPlayer.get_next_frame(&frame)) :
+                                 (keyframe != keyframes.end() && detectionPlayer.get_frame_by_timestamp(&frame, *keyframe));
+    while (frameValid)
+    {
+        int64_t timestamp = frame.get_timestamp();
+        unsigned long frameNumber = frame.get_frame_number();
+
+        if (!interval || (frameNumber - 1) % interval == 0)
+        {
+            worker->set_playhead(timestamp); // The background tracking follows the detection
+
+            std::vector<Selection> detections = detector.detect(*frame.get_mat_frame());
+            std::vector<bool> found(detectedObjects.size(), false);
+
+            for (Selection const &detection: detections)
+            {
+                // The object whose last detection overlaps this one the most
+                int best = -1;
+                double bestOverlap = VIDEOTRACKING_DETECTION_MIN_OVERLAP;
+                for (unsigned int i = 0; i < detectedObjects.size(); i++)
+                {
+                    double overlap = get_overlap(detectedObjects[i].position, detection);
+                    if (!found[i] && overlap >= bestOverlap)
+                    {
+                        best = i;
+                        bestOverlap = overlap;
+                    }
+                }
+
+                if (best < 0)
+                { // A new object
+                    // The detection frame is already decoded; the main player is not moved
+                    int id = add_object(std::make_shared<TrackedObject>(appearance, namePrefix + " " + std::to_string(created + 1),
+                                                                        timestamp, detection, frame.get_time_position(), frameNumber,
+                                                                        false, 0, 0, 0),
+                                        &frame);
+
+                    created++;
+                    detectedObjects.push_back(DetectedObject{static_cast<unsigned int>(id), detection, 0, 0, 0, 0});
+                    found.push_back(true);
+                    continue;
+                }
+
+                found[best] = true;
+                DetectedObject &object = detectedObjects[best];
+                object.position = detection;
+                object.misses = 0;
+
+                Selection tracked;
+                bool trackedSet;
+                {
+                    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+                    int64_t lastProcessedTimestamp;
+                    auto trackedObject = trackedObjects[object.id];
+                    trackedSet = trackedObject->get_last_processed_timestamp(lastProcessedTimestamp) &&
+                            lastProcessedTimestamp >= timestamp && trackedObject->get_position(timestamp, tracked);
+                }
+                tracked.x -= tracked.width / 2; // Trajectory contains centers
+                tracked.y -= tracked.height / 2;
+
+                // The tracker fills in between detections; when it is not there yet or has drifted, the detection wins
+                if (!trackedSet || get_overlap(tracked, detection) < VIDEOTRACKING_DETECTION_CONFIRM_OVERLAP)
+                    set_object_trajectory_section(object.id, timestamp, detection, frame.get_time_position(), frameNumber);
+            }
+
+            for (unsigned int i = 0; i < detectedObjects.size(); )
+            {
+                DetectedObject &object = detectedObjects[i];
+                if (found[i])
+                {
+                    i++;
+                    continue;
+                }
+
+                if (!object.misses++)
+                {
+                    object.missTimestamp = timestamp;
+                    object.missTimePosition = frame.get_time_position();
+                    object.missFrameNumber = frameNumber;
+                }
+
+                if (object.misses < VIDEOTRACKING_DETECTION_MAX_MISSES)
+                {
+                    i++;
+                    continue;
+                }
+
+                change_object_end_frame(object.id, true, object.missTimestamp, object.missTimePosition, object.missFrameNumber);
+                detectedObjects.erase(detectedObjects.begin() + i);
+                found.erase(found.begin() + i);
+            }
+        }
+
+        progressDialog->setValue(frameNumber);
+        qApp->processEvents(); // Keeps progress bar active
+        if (progressDialog->wasCanceled()) // User canceled the progress dialog
+            throw UserCanceledException();
+
+        if (interval)
+        {
+            frame.set_decode_only((frameNumber % interval) != 0); // The next frame is not detected in
+            frameValid = detectionPlayer.get_next_frame(&frame);
+        }
+        else
+            frameValid = (++keyframe != keyframes.end()) && detectionPlayer.get_frame_by_timestamp(&frame, *keyframe);
+    }
+
+    return created;
+}
+
+double VideoTracker::get_overlap(Selection const &first, Selection const &second) const
+{
+    cv::Rect firstRect(first.x, first.y, first.width, first.height);
+    cv::Rect secondRect(second.x, second.y, second.width, second.height);
+
+    double intersection = (firstRect & secondRect).area();
+    double unionArea = firstRect.area() + secondRect.area() - intersection;
+
+    return unionArea > 0 ? intersection / unionArea : 0;
+}
+
+bool VideoTracker::draw_marks(VideoFrame *frame)
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+
+    int64_t timestamp = frame->get_timestamp();
+    std::vector<std::shared_ptr<TrackedObject>> visibleObjects;
+    for (auto object: trackedObjects)
+    {
+        if ((object->get_first_timestamp() > timestamp) ||
+                ((object->is_end_timestamp_set() && object->get_end_timestamp() < timestamp)) ||
+                object->is_after_scene_cut(timestamp))
+            continue; // In this case the timestamp is out of the range of this tracked object
+
+        visibleObjects.push_back(object);
+    }
+
+    if (visibleObjects.empty())
+        return true; // Nothing is drawn; the picture is encoded as decoded
+
+    compositor.clear();
+    for (auto object: visibleObjects)
+        compositor.add(*object, timestamp); // Objects without a position in this frame, e.g. after a scene cut, are not drawn
+
+    if (compositor.empty())
+        return true;
+
+    std::vector<cv::Mat> planes;
+    if (!frame->get_planes(planes))
+        return false;
+
+    // Defocused objects are computed before anything is drawn; the planes do not need to be copied
+    compositor.compose(planes);
+
+    return true;
+}
 
 bool VideoTracker::track_all(QProgressDialog *progressDialog)
 {
@@ -399,15 +1025,18 @@ bool VideoTracker::track_all(QProgressDialog *progressDialog)
     return true;
 }
 
-QImage VideoTracker::Mat2QImage(Mat const &src) const
+VideoFrame const *VideoTracker::get_tracking_frame(VideoFrame const *frame)
 {
-    Mat temp; // make the same cv::Mat
-    cvtColor(src, temp, CV_BGR2RGB);
-    QImage dest((const uchar *) temp.data, temp.cols, temp.rows, temp.step, QImage::Format_RGB888);
-    dest.bits(); // enforce deep copy, see documentation
-    // of QImage::QImage ( const uchar * data, int width, int height, Format format )
-    return dest;
+    if (frame->get_width() == trackingFrame->get_width() && frame->get_height() == trackingFrame->get_height() &&
+            frame->is_luma_only() == trackingFrame->is_luma_only())
+        return frame;
+
+    if (!trackingFrame->set_scaled_frame(*frame))
+        return frame;
+
+    return trackingFrame;
 }
+
 /**
 bool VideoTracker::set_frame_position(int const &position)
 {
@@ -452,6 +1081,7 @@ unsigned long VideoTracker::get_frame_number() const
 
 unsigned int VideoTracker::get_objects_count() const
 {
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
     return trackedObjects.size();
 }
 
@@ -499,6 +1129,12 @@ void VideoTracker::create_output(std::string const &filename, QProgressDialog &f
     bool isAudio = false;
     //int i = 0;
 
+    // Marks are drawn into the decoded YUV picture; it is not converted to BGR and back
+    VideoFrame outputFrame(player->get_width(), player->get_height());
+    outputFrame.set_yuv_only(true);
+
+    compositor.take_statistics(outputMarkedFrames, outputMarkTime, outputMarkTiles); // Drawing before the output is not counted
+
     qDebug() << "Creating output: Seeking first packet";
 
     if (!player->seek_first_packet())
@@ -524,29 +1160,31 @@ void VideoTracker::create_output(std::string const &filename, QProgressDialog &f
         }
         else
         {
-            if (!player->get_current_frame(currentFrame))
+            if (!player->get_current_frame(&outputFrame))
             {
                 qDebug() << "Error: creating output: cannot get frame.";
                 throw OutputException();
             }
 
-
-           // Mat result = currentFrame->get_mat_frame()->clone(); // Simple assignment would do only a shallow copy, clone() is needed
-            VideoFrame result (*currentFrame); // Simple assignment would do only a shallow copy, clone() is needed
-
             // All trajectories are counted with track_all();
-            // track_frame now only returns those previously counted trajectories.
-            if (!track_frame(currentFrame, *(result.matFrame)))
-                break;
+            // draw_marks() now only draws those previously counted trajectories.
+            if (!draw_marks(&outputFrame))
+            { // The output would miss marks; it is not created
+                qDebug() << "Error: creating output: cannot draw marks.";
+                writer->close_output();
+                delete writer;
+                std::remove(filename.c_str());
+                throw OutputException();
+            }
 
-            if (!writer->write_video_frame(result))
+            if (!writer->write_video_frame(outputFrame))
             {
                 qDebug() << "Error: write_video_frame";
                 throw OutputException();
             }
 
-            qDebug() << currentFrame->get_time_position() << "/" << get_total_time();
-            fileProgressDialog.setValue(currentFrame->get_time_position());
+            qDebug() << outputFrame.get_time_position() << "/" << get_total_time();
+            fileProgressDialog.setValue(outputFrame.get_time_position());
             if (fileProgressDialog.wasCanceled())
             { // todo: close file or delete?
                 writer->close_output();
@@ -560,6 +1198,9 @@ void VideoTracker::create_output(std::string const &filename, QProgressDialog &f
         qDebug() << "WARNING: Creating output: write_last_frames() not correct";
 
     qDebug() << "Creating output: Frames successfully written";
+    compositor.take_statistics(outputMarkedFrames, outputMarkTime, outputMarkTiles);
+    qDebug() << "Creating output: marks drawn into" << outputMarkedFrames << "frames in" << outputMarkTime
+             << "ms per frame with" << outputMarkTiles << "tiles";
 
     qDebug() << "Creating output: Closing output file";
 
@@ -579,46 +1220,160 @@ void VideoTracker::create_output(std::string const &filename, QProgressDialog &f
     //return true;
 }
 
+void VideoTracker::get_output_statistics(unsigned long &frames, double &averageTime, unsigned int &tiles) const
+{
+    frames = outputMarkedFrames;
+    averageTime = outputMarkTime;
+    tiles = outputMarkTiles;
+}
+
 Characteristics VideoTracker::get_object_appearance(unsigned int objectID) const
 {
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
     return trackedObjects[objectID]->get_appearance();
 }
 
-std::map<int64_t, TrajectorySection> const &VideoTracker::get_object_trajectory_sections(unsigned int objectID) const
+std::map<int64_t, TrajectorySection> VideoTracker::get_object_trajectory_sections(unsigned int objectID) const
 {
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
     return trackedObjects[objectID]->get_trajectory_sections();
 }
 
-std::map<int64_t, TrajectoryEntry> const &VideoTracker::get_object_trajectory(unsigned int objectID) const
+std::map<int64_t, TrajectoryEntry> VideoTracker::get_object_trajectory(unsigned int objectID) const
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    Trajectory const &computed = trackedObjects[objectID]->get_trajectory();
+    std::map<int64_t, TrajectoryEntry> trajectory(computed.begin(), computed.end());
+
+    // Include frames tracked backward from the Beginning
+    auto const &sections = trackedObjects[objectID]->get_trajectory_sections();
+    if (!sections.empty())
+        trajectory.insert(sections.begin()->second.backwardTrajectory.begin(), sections.begin()->second.backwardTrajectory.end());
+
+    return trajectory;
+}
+
+bool VideoTracker::get_object_trajectory_changes(unsigned int objectID, unsigned long &version,
+                                                 std::vector<std::pair<int64_t, TrajectoryEntry>> &entries) const
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    Trajectory const &computed = trackedObjects[objectID]->get_trajectory();
+    auto const &sections = trackedObjects[objectID]->get_trajectory_sections();
+
+    entries.clear();
+    std::vector<int64_t> timestamps;
+    bool followed = computed.get_changes(version, timestamps);
+    version = computed.get_version();
+
+    if (!followed)
+    { // The whole trajectory including frames tracked backward from the Beginning
+        std::map<int64_t, TrajectoryEntry> trajectory = get_object_trajectory(objectID);
+        entries.assign(trajectory.begin(), trajectory.end());
+        return false;
+    }
+
+    for (int64_t timestamp: timestamps)
+    {
+        auto entry = computed.find(timestamp);
+        if (entry != computed.end())
+            entries.push_back(*entry);
+        else if (!sections.empty())
+        { // Tracked backward from the Beginning
+            auto backwardEntry = sections.begin()->second.backwardTrajectory.find(timestamp);
+            if (backwardEntry != sections.begin()->second.backwardTrajectory.end())
+                entries.push_back(*backwardEntry);
+        }
+    }
+
+    return true;
+}
+
+bool VideoTracker::get_object_telemetry(unsigned int objectID, double &averageError, double &averageParticles,
+                                        double &averagePruned, double &averageTime, unsigned int &lowConfidence) const
 {
-    return trackedObjects[objectID]->get_trajectory();
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+
+    unsigned long count = 0;
+    averageError = 0;
+    averageParticles = 0;
+    averagePruned = 0;
+    averageTime = 0;
+    lowConfidence = 0;
+
+    auto accumulate = [&](TrajectoryEntry const &entry)
+    {
+        if (entry.interpolated || !entry.particles)
+            return;
+
+        count++;
+        averageError += entry.matchError;
+        averageParticles += entry.particles;
+        averagePruned += entry.prunedParticles;
+        averageTime += entry.evaluationTime;
+        if (entry.is_low_confidence())
+            lowConfidence++;
+    };
+
+    Trajectory const &trajectory = trackedObjects[objectID]->get_trajectory();
+    for (auto const &entry: trajectory)
+        accumulate(entry.second);
+    for (auto const &section: trackedObjects[objectID]->get_trajectory_sections())
+    {
+        for (auto const &entry: section.second.backwardTrajectory)
+        {
+            if (trajectory.find(entry.first) == trajectory.end()) // Forward tracking copies entries where the passes meet
+                accumulate(entry.second);
+        }
+    }
+
+    if (!count)
+        return false;
+
+    averageError /= count;
+    averageParticles /= count;
+    averagePruned /= count;
+    averageTime /= count;
+    return true;
 }
 
 bool VideoTracker::set_object_trajectory_section(unsigned int objectID, int64_t newTimestamp, Selection position,
                                                  unsigned long timePosition, unsigned long frameNumber)
 {
-    return trackedObjects[objectID]->set_trajectory_section(newTimestamp, position, timePosition, frameNumber); //todo check if exists
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    bool result = trackedObjects[objectID]->set_trajectory_section(newTimestamp, position, timePosition, frameNumber); //todo check if exists
+    worker->restart(); // Work done in the background might be invalid now
+    return result;
 }
 
 bool VideoTracker::change_object_trajectory_section(unsigned int objectID, int64_t oldTimestamp, int64_t newTimestamp,
                                                     Selection position, unsigned long timePosition, unsigned long frameNumber)
 {
-    return trackedObjects[objectID]->change_trajectory_section(oldTimestamp, newTimestamp, position, timePosition, frameNumber); //todo check if exists
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    bool result = trackedObjects[objectID]->change_trajectory_section(oldTimestamp, newTimestamp, position, timePosition, frameNumber); //todo check if exists
+    worker->restart(); // Work done in the background might be invalid now
+    return result;
 }
 
 bool VideoTracker::delete_object_trajectory_section(unsigned int objectID, int64_t timestamp)
 {
-    return trackedObjects[objectID]->delete_trajectory_section(timestamp); //todo check if exists
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    bool result = trackedObjects[objectID]->delete_trajectory_section(timestamp); //todo check if exists
+    worker->restart(); // Work done in the background might be invalid now
+    return result;
 }
 
 bool VideoTracker::change_object_end_frame(unsigned int objectID, bool set, int64_t timestamp,
                                            unsigned long timePosition, unsigned long frameNumber)
 {
-    return trackedObjects[objectID]->change_end_frame(set, timestamp, timePosition, frameNumber); //todo test if object exists
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    bool result = trackedObjects[objectID]->change_end_frame(set, timestamp, timePosition, frameNumber); //todo test if object exists
+    worker->restart(); // Work done in the background might be invalid now
+    return result;
 }
 
 bool VideoTracker::get_object_end(unsigned int objectID, int64_t &timestamp, unsigned long &timePosition, unsigned long &frameNumber)
 {
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
     if (!trackedObjects[objectID]->is_end_timestamp_set())
         return false;
 
@@ -628,30 +1383,79 @@ bool VideoTracker::get_object_end(unsigned int objectID, int64_t &timestamp, uns
     return true;
 }
 
+bool VideoTracker::get_object_scene_cut(unsigned int objectID, int64_t &timestamp, unsigned long &timePosition,
+                                        unsigned long &frameNumber) const
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    return trackedObjects[objectID]->get_scene_cut(timestamp, timePosition, frameNumber);
+}
+
+bool VideoTracker::ignore_object_scene_cut(unsigned int objectID)
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    bool result = trackedObjects[objectID]->ignore_scene_cut();
+    worker->restart(); // Work done in the background might be invalid now
+    return result;
+}
+
 bool VideoTracker::change_object_appearance(unsigned int objectID, Characteristics const &newAppearance)
 {
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
     trackedObjects[objectID]->change_appearance(newAppearance);
     return true;
 }
 
 std::string VideoTracker::get_object_name(unsigned int objectID)
 {
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
     return trackedObjects[objectID]->get_name();
 }
 
 void VideoTracker::set_object_name(unsigned int objectID, std::string newName)
 {
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
     trackedObjects[objectID]->set_name(newName);
 }
 
 void VideoTracker::delete_object(unsigned int objectID)
 {
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
     assert(trackedObjects.size() > objectID);
+    cachedVersions.erase(trackedObjects[objectID].get());
     trackedObjects.erase(trackedObjects.begin()+objectID);
+    objectsRevision = TrackedObject::new_revision(); // Frames with the object's marks are outdated
+    worker->restart();
+}
+
+void VideoTracker::set_object_tracking_stride(unsigned int objectID, unsigned int stride)
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    trackedObjects[objectID]->set_tracking_stride(stride);
+    worker->restart(); // Work done in the background is invalid now
+}
+
+unsigned int VideoTracker::get_object_tracking_stride(unsigned int objectID) const
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    return trackedObjects[objectID]->get_tracking_stride();
+}
+
+void VideoTracker::set_object_tracking_parameters(unsigned int objectID, TrackingParameters const &parameters)
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    trackedObjects[objectID]->set_tracking_parameters(parameters);
+    worker->restart(); // Work done in the background is invalid now
+}
+
+TrackingParameters VideoTracker::get_object_tracking_parameters(unsigned int objectID) const
+{
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
+    return trackedObjects[objectID]->get_tracking_parameters();
 }
 
 std::vector<std::string> VideoTracker::get_all_objects_names()
 {
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
     std::vector<std::string> objectNames;
 
     for (unsigned int i = 0; i < trackedObjects.size(); i++)
@@ -662,8 +1466,11 @@ std::vector<std::string> VideoTracker::get_all_objects_names()
 
 void VideoTracker::erase_object_trajectories_to_comply()
 {
+    std::lock_guard<std::recursive_mutex> lock(objectsMutex);
     for (auto object: trackedObjects)
     {
         object->erase_trajectory_to_comply();
     }
+
+    worker->restart();
 }
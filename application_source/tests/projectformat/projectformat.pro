@@ -0,0 +1,110 @@
+
+# FILE projectformat.pro
+# AUTOR agent (agent@local)
+# DATE October, 2026
+
+# Loads projects saved in older formats; run from the build directory with "make check"
+
+QT += core gui testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+QMAKE_CXXFLAGS += -std=c++0x
+
+TARGET = tst_projectformat
+TEMPLATE = app
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+ROOT = $$PWD/../..
+
+DEFINES += TEST_DATA_DIR=\\\"$$PWD/data/\\\"
+
+INCLUDEPATH += $$ROOT/3rd_party
+INCLUDEPATH += $$ROOT/headers
+
+SOURCES += \
+    tst_projectformat.cpp \
+    $$ROOT/sources/avwriter.cpp \
+    $$ROOT/sources/colors.cpp \
+    $$ROOT/sources/ffmpegplayer.cpp \
+    $$ROOT/sources/foregroundmask.cpp \
+    $$ROOT/sources/framecache.cpp \
+    $$ROOT/sources/imagepool.cpp \
+    $$ROOT/sources/markcompositor.cpp \
+    $$ROOT/sources/objectdetector.cpp \
+    $$ROOT/sources/objectshape.cpp \
+    $$ROOT/sources/projectformat.cpp \
+    $$ROOT/sources/skincolormap.cpp \
+    $$ROOT/sources/trackedobject.cpp \
+    $$ROOT/sources/trackingalgorithm.cpp \
+    $$ROOT/sources/trackingpreset.cpp \
+    $$ROOT/sources/trackingworker.cpp \
+    $$ROOT/sources/videoframe.cpp \
+    $$ROOT/sources/videotracker.cpp \
+    $$ROOT/sources/trajectory.cpp
+
+unix {
+
+message(Platform: unix)
+
+QMAKE_CXXFLAGS += -Wall -Wextra -pedantic
+
+CONFIG += link_pkgconfig # Only with unix/linux?
+PKGCONFIG += opencv
+
+INCLUDEPATH += /usr/include/ffmpeg
+
+#PKGCONFIG += ffmpeg
+#OPENCV_PATH = /ucr/include/opencv
+#OPENCV_PATH = /ucr/include/opencv2
+#INCLUDEPATH += $$OPENCV_PATH
+
+LIBS +=  \
+    #-lopencv\
+    -lopencv_core \
+    -lopencv_highgui \
+    -lopencv_imgproc \
+    -lopencv_objdetect \
+    -lopencv_video \
+\
+    -lavdevice \
+    -lavformat \
+    -lavfilter \
+    -lavcodec \
+    -lswresample \
+    -lswscale \
+    -lavutil \
+\
+    -lm \
+    -lz \
+    -lpthread \
+    -lpostproc
+}
+
+win32 { #MSVC compiler
+
+message(Platform: win32)
+
+INCLUDEPATH += $$ROOT/3rd_party/ffmpeg_win32
+INCLUDEPATH += $$ROOT/3rd_party/opencv_win32
+INCLUDEPATH += $$ROOT/3rd_party/opencv_win32/opencv
+
+LIBS += -L$$ROOT/lib_win32/opencv \
+    -lopencv_core2411 \
+    -lopencv_highgui2411 \
+    -lopencv_imgproc2411 \
+    -lopencv_objdetect2411 \
+    -lopencv_video2411 \
+\
+    -L$$ROOT/lib_win32/ffmpeg \
+    -lavdevice \
+    -lavformat \
+    -lavfilter \
+    -lavcodec \
+    -lswresample \
+    -lswscale \
+    -lavutil \
+
+}
+
@@ -0,0 +1,154 @@
+/**
+ * @file tst_projectformat.cpp
+ * @author agent (agent@local)
+ * @date October, 2026
+ */
+
+#include "videotracker.h"
+#include "projectformat.h"
+#include "colors.h"
+
+#include <cereal/archives/json.hpp>
+#include <cereal/archives/xml.hpp>
+#include <cereal/types/memory.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/map.hpp>
+#include <cereal/types/utility.hpp>
+
+#include <QtTest>
+
+#include <fstream>
+#include <sstream>
+
+/**
+ * Loads projects the same way as MainWindow::load_project(). The data directory contains projects
+ * saved by the version preceding the project format.
+ */
+class TestProjectFormat : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void load_baseline_json();
+    void load_baseline_xml();
+    void save_and_load();
+
+private:
+    struct Project
+    {
+        std::uint32_t format;
+        std::string inputFileName;
+        std::unique_ptr<VideoTracker> tracker;
+        unsigned int customColorsCount;
+        std::map<unsigned int, std::pair<std::string, ObjectColor>> colorsMap;
+    };
+
+    template<class Archive>
+    static void load(Archive &iarchive, Project &project)
+    {
+        project.format = ProjectFormat::load(iarchive);
+        ProjectFormat projectFormat(project.format);
+        iarchive(cereal::make_nvp("inputFileName", project.inputFileName), cereal::make_nvp("tracker", project.tracker),
+                 cereal::make_nvp("customColorsCount", project.customColorsCount), cereal::make_nvp("colors", project.colorsMap));
+    }
+
+    static void check_baseline(Project const &project);
+};
+
+void TestProjectFormat::load_baseline_json()
+{
+    std::ifstream is(TEST_DATA_DIR "baseline_project.json");
+    QVERIFY(is.good());
+
+    Project project;
+    cereal::JSONInputArchive iarchive(is);
+    load(iarchive, project);
+    check_baseline(project);
+}
+
+void TestProjectFormat::load_baseline_xml()
+{
+    std::ifstream is(TEST_DATA_DIR "baseline_project.xml");
+    QVERIFY(is.good());
+
+    Project project;
+    cereal::XMLInputArchive iarchive(is);
+    load(iarchive, project);
+    check_baseline(project);
+}
+
+void TestProjectFormat::save_and_load()
+{
+    Project baseline;
+    {
+        std::ifstream is(TEST_DATA_DIR "baseline_project.json");
+        cereal::JSONInputArchive iarchive(is);
+        load(iarchive, baseline);
+    }
+
+    Characteristics appearance = baseline.tracker->get_object_appearance(0);
+    appearance.blur = true;
+    baseline.tracker->change_object_appearance(0, appearance);
+    baseline.tracker->set_object_tracking_stride(0, 3);
+
+    std::stringstream stream;
+    {
+        std::uint32_t projectFormat = VIDEOTRACKING_PROJECT_FORMAT;
+        cereal::JSONOutputArchive oarchive(stream);
+        oarchive(CEREAL_NVP(projectFormat), cereal::make_nvp("inputFileName", baseline.inputFileName),
+                 cereal::make_nvp("tracker", baseline.tracker), cereal::make_nvp("customColorsCount", baseline.customColorsCount),
+                 cereal::make_nvp("colors", baseline.colorsMap));
+    }
+
+    Project project;
+    {
+        cereal::JSONInputArchive iarchive(stream);
+        load(iarchive, project);
+    }
+
+    QCOMPARE(project.format, static_cast<std::uint32_t>(VIDEOTRACKING_PROJECT_FORMAT));
+    QCOMPARE(project.tracker->get_objects_count(), 2u);
+    QVERIFY(project.tracker->get_object_appearance(0).blur);
+    QCOMPARE(project.tracker->get_object_tracking_stride(0), 3u);
+    QCOMPARE(project.tracker->get_object_trajectory(0).size(), static_cast<size_t>(2));
+}
+
+void TestProjectFormat::check_baseline(Project const &project)
+{
+    QCOMPARE(project.format, 0u);
+    QCOMPARE(project.inputFileName, std::string("video.mp4"));
+    QCOMPARE(project.customColorsCount, 1u);
+    QCOMPARE(project.colorsMap.at(0).first, std::string("Custom"));
+    QVERIFY(project.tracker);
+    QCOMPARE(project.tracker->get_objects_count(), 2u);
+
+    // Fields of the baseline are loaded
+    QCOMPARE(project.tracker->get_object_name(0), std::string("Face"));
+    QCOMPARE(project.tracker->get_object_name(1), std::string("Plate"));
+    Characteristics appearance = project.tracker->get_object_appearance(0);
+    QVERIFY(appearance.defocus);
+    QCOMPARE(appearance.defocusSize, 12u);
+
+    int64_t endTimestamp;
+    unsigned long endTimePosition;
+    unsigned long endFrameNumber;
+    QVERIFY(project.tracker->get_object_end(0, endTimestamp, endTimePosition, endFrameNumber));
+    QCOMPARE(endTimestamp, static_cast<int64_t>(400));
+    QVERIFY(!project.tracker->get_object_end(1, endTimestamp, endTimePosition, endFrameNumber));
+
+    std::map<int64_t, TrajectoryEntry> trajectory = project.tracker->get_object_trajectory(0);
+    QCOMPARE(trajectory.size(), static_cast<size_t>(2));
+    QCOMPARE(trajectory.at(80).position.x, 104);
+    QCOMPARE(trajectory.at(80).frameNumber, 3ul);
+
+    // Fields added later keep their defaults
+    QVERIFY(!appearance.blur);
+    QVERIFY(!trajectory.at(80).interpolated);
+    QCOMPARE(trajectory.at(80).particles, static_cast<uint16_t>(0));
+    QCOMPARE(project.tracker->get_object_tracking_stride(0), 1u);
+    QCOMPARE(project.tracker->get_object_tracking_parameters(0).preset, TrackingPreset::BALANCED);
+}
+
+QTEST_APPLESS_MAIN(TestProjectFormat)
+
+#include "tst_projectformat.moc"
@@ -40,18 +40,28 @@ SOURCES += \
     sources/avwriter.cpp \
     sources/colors.cpp \
     sources/ffmpegplayer.cpp \
+    sources/foregroundmask.cpp \
+    sources/framecache.cpp \
     sources/imagelabel.cpp \
+    sources/imagepool.cpp \
     sources/main.cpp \
     sources/mainwindow.cpp \
+    sources/markcompositor.cpp \
+    sources/objectdetector.cpp \
     sources/objectshape.cpp \
     sources/playerslider.cpp \
+    sources/projectformat.cpp \
+    sources/skincolormap.cpp \
     sources/timelabel.cpp \
     sources/trackedobject.cpp \
     sources/trackingalgorithm.cpp \
+    sources/trackingpreset.cpp \
+    sources/trackingworker.cpp \
     sources/videoframe.cpp \
     sources/videotracker.cpp \
     sources/videowidget.cpp \
     sources/anchoritem.cpp \
+    sources/trajectory.cpp \
     sources/trajectoryitem.cpp \
     sources/helpbrowser.cpp
 
@@ -59,18 +69,28 @@ HEADERS += \
     headers/avwriter.h \
     headers/colors.h \
     headers/ffmpegplayer.h \
+    headers/foregroundmask.h \
+    headers/framecache.h \
     headers/imagelabel.h \
+    headers/imagepool.h \
     headers/mainwindow.h \
+    headers/markcompositor.h \
+    headers/objectdetector.h \
     headers/objectshape.h \
     headers/playerslider.h \
+    headers/projectformat.h \
     headers/selection.h \
+    headers/skincolormap.h \
     headers/timelabel.h \
     headers/trackedobject.h \
     headers/trackingalgorithm.h \
+    headers/trackingpreset.h \
+    headers/trackingworker.h \
     headers/videoframe.h \
     headers/videotracker.h \
     headers/videowidget.h \
     headers/anchoritem.h \
+    headers/trajectory.h \
     headers/trajectoryitem.h \
     headers/helpbrowser.h
 
@@ -100,6 +120,7 @@ LIBS +=  \
     -lopencv_core \
     -lopencv_highgui \
     -lopencv_imgproc \
+    -lopencv_objdetect \
     -lopencv_video \
 \
     -lavdevice \
@@ -128,6 +149,7 @@ LIBS += -L$$PWD/lib_win32/opencv \
     -lopencv_core2411 \
     -lopencv_highgui2411 \
     -lopencv_imgproc2411 \
+    -lopencv_objdetect2411 \
     -lopencv_video2411 \
 \
     -L$$PWD/lib_win32/ffmpeg \